@@ -0,0 +1,460 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "sqrt2.h"
+#include "operations.h"
+#include "plan.h"
+#include "perf.h"
+
+const char* bench_usage_msg =
+	"Usage: %s [options]	Benchmarks the arithmetic and the engines over a sweep of sizes\n";
+
+const char* bench_help_msg =
+	"Optional arguments:\n"
+	"  --sizes <int,...>	Sizes in 32 bit blocks to sweep (default: 16,64,256)\n"
+	"  --reps <int>	Measured repetitions per size (default: 5)\n"
+	"  --warmup <int>	Unmeasured repetitions before measuring (default: 1)\n"
+	"  --format <table|csv|json>	Output format (default: table)\n"
+	"  --baseline <file>	Compares the medians against a baseline written earlier with --format csv\n"
+	"  --perf		Adds IPC and cycles, cache, branch and dTLB misses per block from the hardware counters\n"
+	"  --only <name>	Runs only the benchmark called <name>\n"
+	"  --help		Shows help message (this text) and exit\n"
+	"Examples:\n"
+	"  ./sqrt2_bench --format csv > baseline.csv\n"
+	"  ./sqrt2_bench --baseline baseline.csv\n";
+
+#define MAX_SIZES 32
+#define MAX_BASELINE 256
+
+/*
+ * Operands and results of one measurement; setup builds the operands for a size, run is the measured part, teardown frees everything
+ */
+struct bench_ctx {
+	size_t size;
+	struct bignum x;
+	struct bignum y;
+	struct bignum res;
+	FILE *sink;
+};
+
+struct bench {
+	const char *name;
+	void (*setup)(struct bench_ctx *ctx);
+	void (*run)(struct bench_ctx *ctx);
+	void (*teardown)(struct bench_ctx *ctx);
+};
+
+/*
+ * Statistics of the measured repetitions of one benchmark at one size
+ */
+struct bench_result {
+	const char *name;
+	size_t size;
+	double median;
+	double min;
+	double stddev;
+	double baseline;
+	bool counted;
+	uint64_t counts[PERF_EVENT_COUNT];
+};
+
+struct baseline_entry {
+	char name[64];
+	size_t size;
+	double median;
+};
+
+uint64_t rng_state = 0x9e3779b97f4a7c15;
+
+/*
+ * xorshift64, fixed seed so that every run measures the same operands
+ */
+uint32_t nextRandom(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state >> 32;
+}
+
+/*
+ * Initializes num as integer of the given amount of random blocks with a non zero leading block
+ */
+void randomBignum(struct bignum *num, size_t blocks)
+{
+	num->numbers = limbsAlloc(blocks + 1);
+	for (size_t i = 0; i < blocks; i++) {
+		num->numbers[i] = nextRandom();
+	}
+	num->numbers[blocks - 1] |= 1;
+	num->length = blocks;
+	num->subone = 0;
+}
+
+double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+void setupBalanced(struct bench_ctx *ctx)
+{
+	randomBignum(&ctx->x, ctx->size);
+	randomBignum(&ctx->y, ctx->size);
+}
+
+void setupUnbalanced(struct bench_ctx *ctx)
+{
+	randomBignum(&ctx->x, ctx->size);
+	randomBignum(&ctx->y, ctx->size / 4 > 0 ? ctx->size / 4 : 1);
+}
+
+void setupSquare(struct bench_ctx *ctx)
+{
+	randomBignum(&ctx->x, ctx->size);
+	ctx->y = ctx->x;
+}
+
+void setupNone(struct bench_ctx *ctx)
+{
+	bignumInit(&ctx->x, 0);
+	bignumInit(&ctx->y, 0);
+}
+
+/*
+ * Computes sqrt2 with size blocks of subone places as the operand of the output benchmarks
+ */
+void setupResult(struct bench_ctx *ctx)
+{
+	struct plan plan;
+	planCompute(&plan, ctx->size * 8, 16);
+	ctx->x = sqrt2_truncated(plan.terms, plan.prec);
+	bignumInit(&ctx->y, 0);
+	ctx->sink = fopen("/dev/null", "w");
+	if (ctx->sink == NULL) {
+		perror("/dev/null");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void runMult(struct bench_ctx *ctx)
+{
+	ctx->res = karazMult(&ctx->x, &ctx->y);
+}
+
+void runDiv(struct bench_ctx *ctx)
+{
+	ctx->res = newtonDiv(&ctx->x, &ctx->y, 32 * ctx->size);
+}
+
+void runSplit(struct bench_ctx *ctx)
+{
+	struct plan plan;
+	planCompute(&plan, ctx->size * 8, 16);
+	ctx->res = sqrt2(plan.terms, plan.prec);
+}
+
+void runSplitTruncated(struct bench_ctx *ctx)
+{
+	struct plan plan;
+	planCompute(&plan, ctx->size * 8, 16);
+	ctx->res = sqrt2_truncated(plan.terms, plan.prec);
+}
+
+void runPrintHex(struct bench_ctx *ctx)
+{
+	printResultHex(ctx->sink, &ctx->x, ctx->size * 8);
+	bignumInit(&ctx->res, 0);
+}
+
+void runPrintDec(struct bench_ctx *ctx)
+{
+	// Decimal places that fit into size blocks
+	bignumPrintDec(ctx->sink, &ctx->x, ctx->size * 32 * 30103 / 100000);
+	bignumInit(&ctx->res, 0);
+}
+
+void teardownOperands(struct bench_ctx *ctx)
+{
+	if (ctx->y.numbers != ctx->x.numbers) {
+		bignumFree(&ctx->y);
+	}
+	bignumFree(&ctx->x);
+	if (ctx->sink != NULL) {
+		fclose(ctx->sink);
+		ctx->sink = NULL;
+	}
+}
+
+const struct bench benchmarks[] = {
+	{"mul_balanced", setupBalanced, runMult, teardownOperands},
+	{"mul_unbalanced", setupUnbalanced, runMult, teardownOperands},
+	{"mul_square", setupSquare, runMult, teardownOperands},
+	{"newton_div", setupBalanced, runDiv, teardownOperands},
+	{"split", setupNone, runSplit, teardownOperands},
+	{"split_truncated", setupNone, runSplitTruncated, teardownOperands},
+	{"print_hex", setupResult, runPrintHex, teardownOperands},
+	{"print_dec", setupResult, runPrintDec, teardownOperands},
+};
+
+int compareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Runs warmup unmeasured and reps measured repetitions of the benchmark at the given size
+ */
+struct bench_result measure(const struct bench *bench, size_t size, size_t warmup, size_t reps, struct perf_counters *counters)
+{
+	struct bench_result result = {bench->name, size, 0, 0, 0, 0, counters != NULL, {0}};
+
+	struct bench_ctx ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.size = size;
+	bench->setup(&ctx);
+
+	double *times = calloc(reps, sizeof(double));
+	if (times == NULL) {
+		fprintf(stderr, "Error while allocation memory!");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0; i < warmup + reps; i++) {
+		bool counting = counters != NULL && i >= warmup;
+		if (counting) {
+			perfReset(counters);
+			perfStart(counters);
+		}
+		double start = now();
+		bench->run(&ctx);
+		double time = now() - start;
+		if (counting) {
+			perfStop(counters);
+			for (size_t e = 0; e < PERF_EVENT_COUNT; e++) {
+				result.counts[e] += counters->value[e];
+			}
+		}
+		bignumFree(&ctx.res);
+		if (i >= warmup) {
+			times[i - warmup] = time;
+		}
+	}
+	bench->teardown(&ctx);
+
+	double mean = 0;
+	for (size_t i = 0; i < reps; i++) {
+		mean += times[i] / reps;
+	}
+	for (size_t e = 0; e < PERF_EVENT_COUNT; e++) {
+		result.counts[e] /= reps;
+	}
+	for (size_t i = 0; i < reps; i++) {
+		result.stddev += (times[i] - mean) * (times[i] - mean) / reps;
+	}
+	result.stddev = sqrt(result.stddev);
+
+	qsort(times, reps, sizeof(double), compareDouble);
+	result.min = times[0];
+	result.median = reps % 2 == 1 ? times[reps / 2] : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+	free(times);
+	return result;
+}
+
+/*
+ * Reads the name, size and median columns of a baseline written with --format csv; returns the number of entries read
+ */
+size_t loadBaseline(const char *path, struct baseline_entry *entries, size_t max)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	char line[512];
+	size_t count = 0;
+	while (count < max && fgets(line, sizeof(line), file) != NULL) {
+		struct baseline_entry *entry = &entries[count];
+		// The header line does not parse and gets skipped
+		if (sscanf(line, "%63[^,],%zu,%lf", entry->name, &entry->size, &entry->median) == 3) {
+			count++;
+		}
+	}
+	fclose(file);
+	return count;
+}
+
+void printResult(const struct bench_result *result, const char *format, bool first, bool compare)
+{
+	double limbs_per_second = result->size / result->median;
+	double ipc = result->counts[PERF_CYCLES] != 0 ? (double)result->counts[PERF_INSTRUCTIONS] / result->counts[PERF_CYCLES] : 0;
+	double cycles = (double)result->counts[PERF_CYCLES] / result->size;
+	double cache_misses = (double)result->counts[PERF_CACHE_MISSES] / result->size;
+	double branch_misses = (double)result->counts[PERF_BRANCH_MISSES] / result->size;
+	double tlb_misses = (double)result->counts[PERF_DTLB_MISSES] / result->size;
+
+	if (strcmp(format, "csv") == 0) {
+		if (first) {
+			printf("name,size,median_s,min_s,stddev_s,limbs_per_s%s%s\n", compare ? ",baseline_median_s,speedup" : "",
+				result->counted ? ",ipc,cycles_per_limb,cache_misses_per_limb,branch_misses_per_limb,dtlb_misses_per_limb" : "");
+		}
+		printf("%s,%zu,%.9f,%.9f,%.9f,%.1f", result->name, result->size, result->median, result->min, result->stddev, limbs_per_second);
+		if (compare) {
+			printf(",%.9f,%.3f", result->baseline, result->baseline > 0 ? result->baseline / result->median : 0);
+		}
+		if (result->counted) {
+			printf(",%.3f,%.3f,%.3f,%.3f,%.3f", ipc, cycles, cache_misses, branch_misses, tlb_misses);
+		}
+		printf("\n");
+	} else if (strcmp(format, "json") == 0) {
+		printf("%s  {\"name\": \"%s\", \"size\": %zu, \"median_s\": %.9f, \"min_s\": %.9f, \"stddev_s\": %.9f, \"limbs_per_s\": %.1f",
+			first ? "[\n" : ",\n", result->name, result->size, result->median, result->min, result->stddev, limbs_per_second);
+		if (compare) {
+			printf(", \"baseline_median_s\": %.9f, \"speedup\": %.3f", result->baseline, result->baseline > 0 ? result->baseline / result->median : 0);
+		}
+		if (result->counted) {
+			printf(", \"ipc\": %.3f, \"cycles_per_limb\": %.3f, \"cache_misses_per_limb\": %.3f, \"branch_misses_per_limb\": %.3f, \"dtlb_misses_per_limb\": %.3f",
+				ipc, cycles, cache_misses, branch_misses, tlb_misses);
+		}
+		printf("}");
+	} else {
+		if (first) {
+			printf("%-16s %8s %12s %12s %12s %14s%s%s\n", "name", "size", "median [s]", "min [s]", "stddev [s]", "limbs/s", compare ? "     baseline  speedup" : "",
+				result->counted ? "    IPC  cyc/limb  cmiss/limb  bmiss/limb  tlbmiss/limb" : "");
+		}
+		printf("%-16s %8zu %12.6f %12.6f %12.6f %14.1f", result->name, result->size, result->median, result->min, result->stddev, limbs_per_second);
+		if (compare) {
+			if (result->baseline > 0) {
+				printf(" %12.6f %7.2fx", result->baseline, result->baseline / result->median);
+			} else {
+				printf(" %12s %8s", "-", "-");
+			}
+		}
+		if (result->counted) {
+			printf(" %6.2f %9.1f %11.3f %11.3f %13.3f", ipc, cycles, cache_misses, branch_misses, tlb_misses);
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	size_t sizes[MAX_SIZES] = {16, 64, 256};
+	size_t size_count = 3;
+	size_t reps = 5;
+	size_t warmup = 1;
+	const char* format = "table";
+	const char* baseline_path = NULL;
+	const char* only = NULL;
+	bool use_perf = false;
+
+	static struct option long_options[] = {
+		{"sizes",     required_argument,  0,  's' },
+		{"reps",      required_argument,  0,  'r' },
+		{"warmup",    required_argument,  0,  'w' },
+		{"format",    required_argument,  0,  'f' },
+		{"baseline",  required_argument,  0,  'b' },
+		{"only",      required_argument,  0,  'o' },
+		{"perf",      no_argument,	   0,  'p' },
+		{"help",      no_argument,	   0,  'h' },
+		{0,	      0,		   0,  0 }
+	};
+
+	int opt;
+	int long_index = 0;
+	while ((opt = getopt_long(argc, argv, "", long_options, &long_index)) != -1) {
+		switch (opt) {
+			case 's': {
+				size_count = 0;
+				char *next = optarg;
+				while (*next != '\0' && size_count < MAX_SIZES) {
+					sizes[size_count] = strtoull(next, &next, 10);
+					if (sizes[size_count] == 0) {
+						printf("Sizes have to be positive numbers of blocks!\n");
+						return EXIT_FAILURE;
+					}
+					size_count++;
+					if (*next == ',') {
+						next++;
+					}
+				}
+				break;
+			}
+			case 'r':
+				reps = strtoull(optarg, NULL, 10);
+				if (reps == 0) {
+					printf("At least one repetition is needed!\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'w':
+				warmup = strtoull(optarg, NULL, 10);
+				break;
+			case 'f':
+				format = optarg;
+				if (strcmp(format, "table") != 0 && strcmp(format, "csv") != 0 && strcmp(format, "json") != 0) {
+					printf("Unknown format %s, use table, csv or json!\n", format);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'b':
+				baseline_path = optarg;
+				break;
+			case 'o':
+				only = optarg;
+				break;
+			case 'p':
+				use_perf = true;
+				break;
+			default:
+				fprintf(stderr, bench_usage_msg, argv[0]);
+				fprintf(stderr, "\n%s", bench_help_msg);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	struct baseline_entry baseline[MAX_BASELINE];
+	size_t baseline_count = baseline_path != NULL ? loadBaseline(baseline_path, baseline, MAX_BASELINE) : 0;
+
+	// Without counters only the wall times are measured
+	struct perf_counters counters;
+	bool counting = use_perf && perfOpen(&counters);
+	if (use_perf && !counting) {
+		perfClose(&counters);
+		fprintf(stderr, "Hardware counters unavailable (perf_event_open failed), measuring wall time only\n");
+	}
+
+	bool first = true;
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+		if (only != NULL && strcmp(only, benchmarks[b].name) != 0) {
+			continue;
+		}
+		for (size_t i = 0; i < size_count; i++) {
+			struct bench_result result = measure(&benchmarks[b], sizes[i], warmup, reps, counting ? &counters : NULL);
+			for (size_t j = 0; j < baseline_count; j++) {
+				if (strcmp(baseline[j].name, result.name) == 0 && baseline[j].size == result.size) {
+					result.baseline = baseline[j].median;
+				}
+			}
+			printResult(&result, format, first, baseline_path != NULL);
+			first = false;
+		}
+	}
+	if (strcmp(format, "json") == 0) {
+		printf(first ? "[]\n" : "\n]\n");
+	}
+	if (counting) {
+		perfClose(&counters);
+	}
+	return EXIT_SUCCESS;
+}
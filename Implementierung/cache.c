@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+// Entries are named after the number of binary subone places they hold
+#define ENTRY_FORMAT "sqrt2_%zu.bin"
+#define PATH_LENGTH 4096
+
+/*
+ * Calls visit for every entry in the cache directory with the precision it holds; stops early if visit returns false
+ */
+void cacheForEach(const char *dir, bool (*visit)(const char *dir, const char *name, size_t prec, void *arg), void *arg)
+{
+	DIR *handle = opendir(dir);
+	if (handle == NULL) {
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(handle)) != NULL) {
+		size_t prec;
+		char check[64];
+		// Only names that are exactly in the entry format count, temporary files are skipped
+		if (sscanf(entry->d_name, ENTRY_FORMAT, &prec) != 1) {
+			continue;
+		}
+		snprintf(check, sizeof(check), ENTRY_FORMAT, prec);
+		if (strcmp(check, entry->d_name) != 0) {
+			continue;
+		}
+		if (!visit(dir, entry->d_name, prec, arg)) {
+			break;
+		}
+	}
+	closedir(handle);
+}
+
+/*
+ * Remembers the least precise entry that still holds at least the requested precision
+ */
+struct best_entry {
+	size_t wanted;
+	size_t prec;
+	char name[256];
+};
+
+bool findBest(const char *dir, const char *name, size_t prec, void *arg)
+{
+	(void)dir;
+	struct best_entry *best = arg;
+	if (prec >= best->wanted && (best->prec == 0 || prec < best->prec)) {
+		best->prec = prec;
+		snprintf(best->name, sizeof(best->name), "%s", name);
+	}
+	return true;
+}
+
+/*
+ * Looks for an entry with at least prec binary subone places and truncates it to prec places into result
+ * Returns false on a miss; entry_prec receives the precision of the entry that served the request
+ */
+bool cacheLookup(const char *dir, size_t prec, struct bignum *result, size_t *entry_prec)
+{
+	struct best_entry best = {prec, 0, ""};
+	cacheForEach(dir, findBest, &best);
+	if (best.prec == 0) {
+		return false;
+	}
+
+	char path[PATH_LENGTH];
+	snprintf(path, sizeof(path), "%s/%s", dir, best.name);
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = bignumRead(file, result);
+	fclose(file);
+
+	// A damaged entry is treated as a miss and gets replaced by the following store
+	if (!ok || result->subone * 32 < prec) {
+		if (ok) {
+			bignumFree(result);
+		}
+		return false;
+	}
+
+	// Truncating a more precise result gives exactly the digits a computation with less places would give
+	cutToBits(result, prec);
+
+	*entry_prec = best.prec;
+	return true;
+}
+
+/*
+ * Removes every entry holding less than the given precision, since the new entry supersedes it
+ */
+bool removeSmaller(const char *dir, const char *name, size_t prec, void *arg)
+{
+	if (prec < *(size_t *)arg) {
+		char path[PATH_LENGTH];
+		snprintf(path, sizeof(path), "%s/%s", dir, name);
+		remove(path);
+	}
+	return true;
+}
+
+/*
+ * Size and modification time of an entry, collected by listEntry to keep the directory within its limit
+ */
+struct entry_info {
+	char name[64];
+	size_t size;
+	struct timespec mtime;
+};
+
+/*
+ * Entries of a cache directory and their total size in bytes, failed is set if the list could not grow
+ */
+struct entry_list {
+	struct entry_info *entries;
+	size_t count;
+	size_t capacity;
+	size_t total;
+	bool failed;
+};
+
+/*
+ * Adds an entry with its size and modification time to the list
+ */
+bool listEntry(const char *dir, const char *name, size_t prec, void *arg)
+{
+	(void)prec;
+	struct entry_list *list = arg;
+	char path[PATH_LENGTH];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	struct stat info;
+	if (stat(path, &info) != 0) {
+		return true;
+	}
+	if (list->count == list->capacity) {
+		size_t capacity = list->capacity != 0 ? 2 * list->capacity : 16;
+		struct entry_info *entries = realloc(list->entries, capacity * sizeof(*entries));
+		if (entries == NULL) {
+			list->failed = true;
+			return false;
+		}
+		list->entries = entries;
+		list->capacity = capacity;
+	}
+	struct entry_info *entry = &list->entries[list->count++];
+	snprintf(entry->name, sizeof(entry->name), "%s", name);
+	entry->size = info.st_size;
+	entry->mtime = info.st_mtim;
+	list->total += entry->size;
+	return true;
+}
+
+/*
+ * Orders entries from the least to the most recently written one
+ */
+int compareAge(const void *x, const void *y)
+{
+	const struct timespec *a = &((const struct entry_info *)x)->mtime;
+	const struct timespec *b = &((const struct entry_info *)y)->mtime;
+	if (a->tv_sec != b->tv_sec) {
+		return a->tv_sec < b->tv_sec ? -1 : 1;
+	}
+	return a->tv_nsec < b->tv_nsec ? -1 : a->tv_nsec > b->tv_nsec;
+}
+
+/*
+ * Removes the oldest entries other than the one named keep until all entries of the directory fit into limit bytes together
+ */
+void cacheEvict(const char *dir, const char *keep, size_t limit)
+{
+	struct entry_list list = {NULL, 0, 0, 0, false};
+	cacheForEach(dir, listEntry, &list);
+	if (!list.failed) {
+		qsort(list.entries, list.count, sizeof(*list.entries), compareAge);
+		for (size_t i = 0; i < list.count && list.total > limit; i++) {
+			if (strcmp(list.entries[i].name, keep) == 0) {
+				continue;
+			}
+			char path[PATH_LENGTH];
+			snprintf(path, sizeof(path), "%s/%s", dir, list.entries[i].name);
+			if (remove(path) == 0) {
+				list.total -= list.entries[i].size;
+			}
+		}
+	}
+	free(list.entries);
+}
+
+/*
+ * Stores result with prec binary subone places in the cache directory, creating it if needed, and removes all superseded entries
+ * With a limit the entries of the directory stay within limit bytes together (no limit if limit is 0), the oldest ones get removed
+ * to make room; the entry is not stored if it alone would be larger; returns false if it was not stored
+ */
+bool cacheStore(const char *dir, const struct bignum *result, size_t prec, size_t limit)
+{
+	size_t size = 2 * sizeof(uint64_t) + result->length * sizeof(uint32_t);
+	if (limit != 0 && size > limit) {
+		return false;
+	}
+
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		return false;
+	}
+
+	char path[PATH_LENGTH];
+	char tmp_path[PATH_LENGTH];
+	snprintf(path, sizeof(path), "%s/" ENTRY_FORMAT, dir, prec);
+	snprintf(tmp_path, sizeof(tmp_path), "%s/" ENTRY_FORMAT ".XXXXXX", dir, prec);
+
+	// Every writer fills a temporary file of its own and renames it into place once complete, so that neither concurrent readers
+	// nor other writers of the same precision see or produce a partial entry
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		return false;
+	}
+	FILE *file = fchmod(fd, 0644) == 0 ? fdopen(fd, "wb") : NULL;
+	if (file == NULL) {
+		close(fd);
+		remove(tmp_path);
+		return false;
+	}
+	bool ok = bignumWrite(file, result);
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(tmp_path, path) != 0) {
+		remove(tmp_path);
+		return false;
+	}
+
+	cacheForEach(dir, removeSmaller, &prec);
+	if (limit != 0) {
+		cacheEvict(dir, strrchr(path, '/') + 1, limit);
+	}
+	return true;
+}
+
+/*
+ * Counts a hit or a miss in the stats file of the cache directory and returns the updated counters in stats
+ * The file stays locked while it gets read and rewritten, so that runs sharing the directory do not lose each other's counts
+ */
+void cacheRecord(const char *dir, bool hit, struct cache_stats *stats)
+{
+	char path[PATH_LENGTH];
+	snprintf(path, sizeof(path), "%s/stats", dir);
+
+	stats->hits = hit;
+	stats->misses = !hit;
+	mkdir(dir, 0777);
+	int fd = open(path, O_RDWR | O_CREAT, 0666);
+	if (fd < 0) {
+		return;
+	}
+	FILE *file = fdopen(fd, "r+");
+	if (file == NULL) {
+		close(fd);
+		return;
+	}
+	// Closing the file releases the lock
+	if (flock(fd, LOCK_EX) != 0) {
+		fclose(file);
+		return;
+	}
+
+	size_t hits, misses;
+	if (fscanf(file, "hits %zu misses %zu", &hits, &misses) == 2) {
+		stats->hits += hits;
+		stats->misses += misses;
+	}
+	rewind(file);
+	fprintf(file, "hits %zu misses %zu\n", stats->hits, stats->misses);
+	// Only the first line gets read, dropping what an unreadable file had beyond it just keeps the file tidy
+	fflush(file);
+	int truncated = ftruncate(fd, ftell(file));
+	(void)truncated;
+	fclose(file);
+}
@@ -0,0 +1,35 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "operations.h"
+
+/*
+ * Hit and miss counters of a cache directory, kept in the file stats inside of it
+ */
+struct cache_stats {
+	size_t hits;
+	size_t misses;
+};
+
+/*
+ * What a request found in the cache: whether it was served from the entry of entry_prec bits, whether the computed result got stored
+ * otherwise, and the counters of the directory afterwards; used is false if the request did not consult the cache
+ */
+struct cache_report {
+	bool used;
+	bool hit;
+	bool stored;
+	size_t entry_prec;
+	struct cache_stats stats;
+};
+
+bool cacheLookup(const char *dir, size_t prec, struct bignum *result, size_t *entry_prec);
+
+bool cacheStore(const char *dir, const struct bignum *result, size_t prec, size_t limit);
+
+void cacheRecord(const char *dir, bool hit, struct cache_stats *stats);
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libsqrt2.h"
+#include "operations.h"
+#include "plan.h"
+#include "cache.h"
+#include "progress.h"
+
+// Thresholds measured for this machine by make tune, the defaults below apply to the values it did not write
+#if __has_include("tuning.h")
+#include "tuning.h"
+#endif
+
+#ifndef TUNING_BASECASE_SCALAR
+#define TUNING_BASECASE_SCALAR 48
+#endif
+#ifndef TUNING_BASECASE_AVX2
+#define TUNING_BASECASE_AVX2 256
+#endif
+#ifndef TUNING_BASECASE_IFMA
+#define TUNING_BASECASE_IFMA 768
+#endif
+#ifndef TUNING_PARALLEL_GRAIN
+#define TUNING_PARALLEL_GRAIN 256
+#endif
+// Working precision in bits from which the truncated splitting beats the series
+#ifndef TUNING_ENGINE_SPLIT_BITS
+#define TUNING_ENGINE_SPLIT_BITS 14000
+#endif
+// Peak memory of the engines in hundredths of a unit, the defaults measured by make tune at 100000 places: the exact splitting in
+// bytes of Q(1, n), saved runs of it including their state as well, the truncated splitting and the series in bytes of the working
+// precision, and the exponent of the threads the truncated splitting grows with (see planMemory)
+#ifndef TUNING_MEMORY_SPLIT
+#define TUNING_MEMORY_SPLIT 615
+#endif
+#ifndef TUNING_MEMORY_SAVED
+#define TUNING_MEMORY_SAVED 889
+#endif
+#ifndef TUNING_MEMORY_TRUNCATED
+#define TUNING_MEMORY_TRUNCATED 3370
+#endif
+#ifndef TUNING_MEMORY_THREADS
+#define TUNING_MEMORY_THREADS 77
+#endif
+#ifndef TUNING_MEMORY_SERIES
+#define TUNING_MEMORY_SERIES 200
+#endif
+// Costs of the arithmetic in picoseconds per block for --estimate, the defaults measured at the default base case of the ifma kernel;
+// make tune replaces them by the ones of this machine
+#ifndef TUNING_PRODUCT_PS
+#define TUNING_PRODUCT_PS 85
+#endif
+#ifndef TUNING_ROW_PS
+#define TUNING_ROW_PS 11000
+#endif
+#ifndef TUNING_STEP_PS
+#define TUNING_STEP_PS 17000
+#endif
+#ifndef TUNING_LINEAR_PS
+#define TUNING_LINEAR_PS 760
+#endif
+#ifndef TUNING_DIVIDE_PS
+#define TUNING_DIVIDE_PS 3800
+#endif
+#ifndef TUNING_PRINT_PS
+#define TUNING_PRINT_PS 56000
+#endif
+#ifndef TUNING_CALL_PS
+#define TUNING_CALL_PS 50000
+#endif
+
+/*
+ * Header in front of every block allocation; allocations made during a library call are linked into the list of the calling thread,
+ * so that all of them can be freed if the call fails part way
+ * maps and numa keep whether the allocation may get a mapping with huge pages and where its pages go, as decided by the context it
+ * was made in, so that resizing it later does not depend on the call running then
+ */
+struct alloc_header {
+	// Aligned so that the blocks behind the header stay 16 byte aligned
+	_Alignas(16) size_t bytes;
+	const struct sqrt2_allocator *allocator;
+	struct alloc_header *prev;
+	struct alloc_header *next;
+	bool maps;
+	enum sqrt2_numa numa;
+};
+
+/*
+ * Per thread state of a running library call: the allocations made so far and where to continue if the call fails
+ * call is the outermost tracker of the call, shared by the trackers nested in it and by those of the threads it starts; only its
+ * threads and spare_threads count: the threads the call may use and how many it may still start besides the running ones
+ */
+struct tracker {
+	struct sqrt2_ctx *ctx;
+	struct alloc_header list;
+	struct tracker *outer;
+	struct tracker *call;
+	size_t threads;
+	size_t spare_threads;
+	int status;
+	jmp_buf jump;
+};
+
+struct sqrt2_ctx {
+	struct sqrt2_allocator allocator;
+	struct sqrt2_tuning tuning;
+	enum sqrt2_engine engine;
+	size_t threads;
+	// Worker processes the splitting gets distributed over, each of them using threads
+	size_t processes;
+	// Budget of the memory held by the running calls, no limit if max_bytes is 0
+	size_t max_bytes;
+	size_t live_bytes;
+	// Checks the merges by residues and the result by squaring
+	bool verify;
+	// Maps large blocks with huge pages, placed as numa says
+	bool huge_pages;
+	enum sqrt2_numa numa;
+	// Most precise result computed so far, best_prec is 0 if there is none
+	struct bignum best;
+	size_t best_prec;
+	// Digit cache the results get served from and stored in, none if cache_dir is NULL, and what the last request found there
+	char *cache_dir;
+	size_t cache_limit;
+	struct cache_report cache;
+	// Program the worker processes run as, the running program itself if worker is NULL
+	char *worker;
+	// Progress of the phase the library calls on the context run
+	struct progress progress;
+};
+
+extern const struct sqrt2_tuning default_tuning;
+
+extern __thread struct tracker *current_tracker;
+
+void *contextAlloc(size_t bytes);
+
+void *contextRealloc(void *ptr, size_t bytes);
+
+void contextFree(void *ptr);
+
+void contextFail(int status, const char *message);
+
+struct sqrt2_ctx *contextCurrent(void);
+
+const struct sqrt2_tuning *contextTuning(void);
+
+void trackerBegin(struct tracker *tracker, struct sqrt2_ctx *ctx);
+
+void trackerEnd(struct tracker *tracker);
+
+void trackerLeave(struct tracker *tracker);
+
+void trackerAdopt(struct tracker *tracker, struct tracker *child);
+
+void trackerAbort(struct tracker *tracker);
+
+bool trackerTakeThread(void);
+
+void trackerReturnThread(void);
+
+int sqrt2Plan(struct sqrt2_ctx *ctx, unsigned base, size_t digits, struct plan *plan);
+
+int sqrt2Value(struct sqrt2_ctx *ctx, unsigned base, size_t digits, struct bignum *result);
+
+int sqrt2Extend(struct sqrt2_ctx *ctx, unsigned base, size_t digits, const char *load_path, const char *save_path, size_t *loaded_terms,
+	struct bignum *result);
+
+int sqrt2Check(struct sqrt2_ctx *ctx, const struct bignum *x, size_t bits);
+
+int sqrt2Multiply(struct sqrt2_ctx *ctx, struct bignum *x, struct bignum *y, struct bignum *product);
+
+const struct cache_report *sqrt2CacheReport(const struct sqrt2_ctx *ctx);
+
+struct progress *sqrt2CtxProgress(struct sqrt2_ctx *ctx);
+
+#endif
@@ -0,0 +1,342 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "context.h"
+#include "distribute.h"
+#include "progress.h"
+#include "kernels.h"
+
+#define JOB_MAGIC "SQRT2JOB"
+#define REPLY_MAGIC "SQRT2RES"
+// Program run as worker unless the context sets another one, the running program itself
+#define WORKER_SELF "/proc/self/exe"
+// Most arguments of a worker: program, --split-worker, --threads n, --kernel name, --no-huge-pages, --numa policy, --verify, NULL
+#define WORKER_ARGS 12
+
+/*
+ * Worker process computing the terms [n1, n2), reply is the end of its pipe the coordinator reads the result from
+ */
+struct worker {
+	pid_t pid;
+	FILE *reply;
+	size_t n1, n2;
+	bool need_p;
+	struct pqt res;
+};
+
+/*
+ * Divides the terms [n1, n2) among count workers along the tree the results get merged in, with the terms of each subtree in
+ * proportion to its workers; every worker gets at least one term as long as there are at least count terms
+ */
+static void distributeRanges(struct worker *workers, size_t count, size_t n1, size_t n2, bool need_p)
+{
+	if (count == 1) {
+		workers->n1 = n1;
+		workers->n2 = n2;
+		workers->need_p = need_p;
+		return;
+	}
+	size_t left = count / 2;
+	size_t nm = n1 + (n2 - n1) * left / count;
+	distributeRanges(workers, left, n1, nm, true);
+	distributeRanges(workers + left, count - left, nm, n2, need_p);
+}
+
+/*
+ * Merges the results of the workers in the tree of distributeRanges, truncating every merged node like splitPQT
+ */
+static struct pqt distributeMerge(struct worker *workers, size_t count, size_t keep, bool need_p)
+{
+	if (count == 1) {
+		// The merges of the worker count once its result is here
+		progressTree(workers->n2 - workers->n1);
+		return workers->res;
+	}
+	size_t left = count / 2;
+	struct pqt l = distributeMerge(workers, left, keep, true);
+	struct pqt r = distributeMerge(workers + left, count - left, keep, need_p);
+	struct pqt res = pqtMerge(&l, &r, need_p);
+	pqtTrim(&res, keep);
+	progressMerge(workers[count - 1].n2 - workers[0].n1);
+	return res;
+}
+
+/*
+ * Writes a job for the terms [n1, n2)
+ */
+static bool writeJob(FILE *out, size_t n1, size_t n2, size_t keep, bool need_p)
+{
+	return fwrite(JOB_MAGIC, 1, 8, out) == 8 && streamWrite64(out, n1) && streamWrite64(out, n2) && streamWrite64(out, keep)
+		&& streamWrite64(out, need_p) && fflush(out) == 0;
+}
+
+/*
+ * Writes the reply to a job, res is only written if status is SQRT2_OK
+ */
+static bool writeReply(FILE *out, int status, const struct pqt *res)
+{
+	double err = status == SQRT2_OK ? res->err : 0;
+	uint64_t err_bits;
+	memcpy(&err_bits, &err, sizeof(err_bits));
+	bool ok = fwrite(REPLY_MAGIC, 1, 8, out) == 8 && streamWrite64(out, status) && streamWrite64(out, err_bits);
+	if (ok && status == SQRT2_OK) {
+		ok = bignumWrite(out, &res->P) && bignumWrite(out, &res->Q) && bignumWrite(out, &res->T);
+	}
+	return ok && fflush(out) == 0;
+}
+
+/*
+ * Reads the reply of a worker into res; returns the status of the worker, SQRT2_EINTERNAL if the reply is broken
+ * Nothing stays allocated unless the status is SQRT2_OK
+ */
+static int readReply(FILE *in, struct pqt *res)
+{
+	char magic[8];
+	uint64_t code, err_bits;
+	if (fread(magic, 1, 8, in) != 8 || memcmp(magic, REPLY_MAGIC, 8) != 0 || !streamRead64(in, &code) || !streamRead64(in, &err_bits)) {
+		return SQRT2_EINTERNAL;
+	}
+	double err;
+	memcpy(&err, &err_bits, sizeof(err));
+	if (code != SQRT2_OK) {
+		return code <= SQRT2_EINTERNAL ? (int)code : SQRT2_EINTERNAL;
+	}
+
+	if (!bignumRead(in, &res->P)) {
+		return SQRT2_EINTERNAL;
+	}
+	if (!bignumRead(in, &res->Q)) {
+		bignumFree(&res->P);
+		return SQRT2_EINTERNAL;
+	}
+	if (!bignumRead(in, &res->T)) {
+		bignumFree(&res->P);
+		bignumFree(&res->Q);
+		return SQRT2_EINTERNAL;
+	}
+	res->err = err;
+	return SQRT2_OK;
+}
+
+/*
+ * Fills argv with the command line of a worker computing with the settings of the running library call
+ * text holds the number of threads, it has to live as long as argv
+ */
+static void workerArgs(const char **argv, char *text, size_t text_size)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+	size_t count = 0;
+	argv[count++] = ctx->worker != NULL ? ctx->worker : WORKER_SELF;
+	argv[count++] = "--split-worker";
+	argv[count++] = "--threads";
+	snprintf(text, text_size, "%zu", current_tracker->call->threads);
+	argv[count++] = text;
+	argv[count++] = "--kernel";
+	argv[count++] = kernelCurrent()->name;
+	if (!ctx->huge_pages) {
+		argv[count++] = "--no-huge-pages";
+	}
+	if (ctx->numa != SQRT2_NUMA_DEFAULT) {
+		argv[count++] = "--numa";
+		argv[count++] = ctx->numa == SQRT2_NUMA_INTERLEAVE ? "interleave" : "local";
+	}
+	if (ctx->verify) {
+		argv[count++] = "--verify";
+	}
+	argv[count] = NULL;
+}
+
+/*
+ * Starts the worker with the given index as a program of its own, hands it its job and closes the job pipe, so that the worker ends
+ * after replying; the worker reads the job from stdin and writes the reply to stdout like on a remote shell
+ * The coordinator may run other threads, so the child only calls async-signal-safe functions until it executes the worker
+ */
+static bool distributeStart(struct worker *workers, size_t index, size_t keep, const char **argv)
+{
+	// All ends get closed on exec, the worker only keeps its job and reply ends as stdin and stdout
+	int job[2], reply[2], failed[2];
+	if (pipe2(job, O_CLOEXEC) != 0) {
+		return false;
+	}
+	if (pipe2(reply, O_CLOEXEC) != 0) {
+		close(job[0]);
+		close(job[1]);
+		return false;
+	}
+	if (pipe2(failed, O_CLOEXEC) != 0) {
+		close(job[0]);
+		close(job[1]);
+		close(reply[0]);
+		close(reply[1]);
+		return false;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		if (dup2(job[0], STDIN_FILENO) >= 0 && dup2(reply[1], STDOUT_FILENO) >= 0) {
+			execv(argv[0], (char *const *)argv);
+		}
+		// The error number tells the coordinator that the worker did not start, its end of the pipe closes on a successful exec
+		int error = errno;
+		ssize_t written = write(failed[1], &error, sizeof(error));
+		(void)written;
+		_exit(EXIT_FAILURE);
+	}
+	close(job[0]);
+	close(reply[1]);
+	close(failed[1]);
+	int error;
+	bool started = pid > 0 && read(failed[0], &error, sizeof(error)) == 0;
+	close(failed[0]);
+
+	FILE *out = started ? fdopen(job[1], "wb") : NULL;
+	workers[index].reply = started ? fdopen(reply[0], "rb") : NULL;
+	bool ok = out != NULL && workers[index].reply != NULL && writeJob(out, workers[index].n1, workers[index].n2, keep, workers[index].need_p);
+
+	if (out != NULL) {
+		fclose(out);
+	} else {
+		close(job[1]);
+	}
+	workers[index].pid = pid;
+	if (!ok) {
+		if (workers[index].reply != NULL) {
+			fclose(workers[index].reply);
+		} else {
+			close(reply[0]);
+		}
+		if (pid > 0) {
+			kill(pid, SIGTERM);
+			waitpid(pid, NULL, 0);
+		}
+	}
+	return ok;
+}
+
+/*
+ * Closes the pipes of the first count workers and waits for them to end, terminates them first if stop is set
+ * Returns whether all of them ended successfully
+ */
+static bool distributeWait(struct worker *workers, size_t count, bool stop)
+{
+	bool ok = true;
+	for (size_t i = 0; i < count; i++) {
+		fclose(workers[i].reply);
+		if (stop) {
+			kill(workers[i].pid, SIGTERM);
+		}
+		int status;
+		if (waitpid(workers[i].pid, &status, 0) != workers[i].pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+/*
+ * Computes the node of the terms [n1, n2) like splitPQT with one worker process per chunk of terms, up to the number of processes
+ * set in the context of the running library call; all workers compute at once, their results get merged here
+ */
+struct pqt distributeSplit(size_t n1, size_t n2, size_t keep, bool need_p)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+	size_t count = ctx->processes < n2 - n1 ? ctx->processes : n2 - n1;
+	struct worker *workers = contextAlloc(count * sizeof(struct worker));
+	distributeRanges(workers, count, n1, n2, need_p);
+
+	const char *argv[WORKER_ARGS];
+	char threads[32];
+	workerArgs(argv, threads, sizeof(threads));
+	size_t started = 0;
+	while (started < count && distributeStart(workers, started, keep, argv)) {
+		started++;
+	}
+	if (started < count) {
+		distributeWait(workers, started, true);
+		contextFail(SQRT2_EINTERNAL, "Error: starting a worker process failed!\n");
+	}
+
+	// The workers have to be stopped before leaving, also if receiving runs out of memory
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		distributeWait(workers, count, true);
+		contextFail(tracker.status, "Error: receiving the result of a worker failed!\n");
+	}
+	int status = SQRT2_OK;
+	for (size_t i = 0; i < count && status == SQRT2_OK; i++) {
+		status = readReply(workers[i].reply, &workers[i].res);
+	}
+	trackerLeave(&tracker);
+	trackerAdopt(current_tracker, &tracker);
+
+	// Results received so far belong to the running call now and get freed with it if a worker failed
+	if (!distributeWait(workers, count, status != SQRT2_OK) && status == SQRT2_OK) {
+		status = SQRT2_EINTERNAL;
+	}
+	if (status != SQRT2_OK) {
+		contextFail(status, "Error: a worker process failed!\n");
+	}
+
+	struct pqt res = distributeMerge(workers, count, keep, need_p);
+	contextFree(workers);
+	return res;
+}
+
+/*
+ * Reads the fields of a job into job: n1, n2, keep and need_p; returns false unless they describe a range of terms the splitting
+ * can compute, 1 <= n1 < n2 <= SQRT2_MAX_TERMS, so that a broken coordinator cannot make the worker allocate without bounds
+ */
+static bool readJob(FILE *in, uint64_t job[4])
+{
+	for (size_t i = 0; i < 4; i++) {
+		if (!streamRead64(in, &job[i])) {
+			return false;
+		}
+	}
+	return job[0] >= 1 && job[0] < job[1] && job[1] <= SQRT2_MAX_TERMS && job[2] <= SQRT2_MAX_TERMS && job[3] <= 1;
+}
+
+/*
+ * Answers the jobs read from in until it ends, in the library call of the worker; returns false if a stream breaks or a job is invalid
+ */
+bool distributeServe(FILE *in, FILE *out)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+	char magic[8];
+	uint64_t job[4];
+
+	while (fread(magic, 1, 8, in) == 8) {
+		if (memcmp(magic, JOB_MAGIC, 8) != 0 || !readJob(in, job)) {
+			return false;
+		}
+
+		// A failing job gets reported to the coordinator, the worker keeps serving
+		struct tracker tracker;
+		trackerBegin(&tracker, ctx);
+		if (setjmp(tracker.jump) != 0) {
+			trackerAbort(&tracker);
+			if (!writeReply(out, tracker.status, NULL)) {
+				return false;
+			}
+			continue;
+		}
+		struct pqt res = splitParallel(job[0], job[1], job[2], job[3] != 0);
+		bool ok = writeReply(out, SQRT2_OK, &res);
+		pqtFree(&res);
+		trackerEnd(&tracker);
+		if (!ok) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#ifndef DISTRIBUTE_H
+#define DISTRIBUTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "sqrt2.h"
+
+/*
+ * Protocol between the coordinator and a worker, over any pair of byte streams, so that a worker could as well be reached through
+ * a remote shell running sqrt2 --split-worker; all fields are 64 bit values written byte by byte in little-endian order
+ * Job:   "SQRT2JOB", n1, n2, keep, need_p with 1 <= n1 < n2 <= SQRT2_MAX_TERMS
+ * Reply: "SQRT2RES", status, the bits of err as IEEE double, then P, Q and T of the terms [n1, n2) in binary limb format (see
+ *        bignumWrite) if status is SQRT2_OK
+ * A worker answers jobs in order until its input ends
+ */
+
+struct pqt distributeSplit(size_t n1, size_t n2, size_t keep, bool need_p);
+
+bool distributeServe(FILE *in, FILE *out);
+
+#endif
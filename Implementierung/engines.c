@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "context.h"
+#include "kernels.h"
+#include "sqrt2.h"
+#include "engines.h"
+
+static struct bignum computeSplit(const struct plan *plan)
+{
+	return sqrt2(plan->terms, plan->prec);
+}
+
+static struct bignum computeTruncated(const struct plan *plan)
+{
+	return sqrt2_truncated(plan->terms, plan->prec);
+}
+
+static struct bignum computeSeries(const struct plan *plan)
+{
+	// sqrt2_V1 sums the terms 1 to n inclusive, while n of the splitting engines is exclusive
+	return sqrt2_V1(plan->terms - 1, plan->prec);
+}
+
+// Ordered by the precision SQRT2_ENGINE_AUTO picks them from; the exact splitting is never faster, it is only needed for saved runs
+static const struct engine engines[] = {
+	{"series", "series", SQRT2_ENGINE_SERIES, computeSeries, 0},
+	{"truncated", "truncated splitting", SQRT2_ENGINE_TRUNCATED, computeTruncated, TUNING_ENGINE_SPLIT_BITS},
+	{"split", "exact splitting", SQRT2_ENGINE_SPLIT, computeSplit, SIZE_MAX},
+};
+
+#define ENGINE_COUNT (sizeof(engines) / sizeof(engines[0]))
+
+/*
+ * Returns the engine with the given id, NULL for SQRT2_ENGINE_AUTO
+ */
+const struct engine *engineGet(enum sqrt2_engine id)
+{
+	for (size_t i = 0; i < ENGINE_COUNT; i++) {
+		if (engines[i].id == id) {
+			return &engines[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Returns the engine with the given name, NULL if there is none
+ */
+const struct engine *engineFind(const char *name)
+{
+	for (size_t i = 0; i < ENGINE_COUNT; i++) {
+		if (strcmp(engines[i].name, name) == 0) {
+			return &engines[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Returns the names of all engines for usage messages
+ */
+const char *engineNames(void)
+{
+	return "series, truncated, split";
+}
+
+/*
+ * Picks the engine for the working precision of the plan: the one with the highest crossover the precision reaches,
+ * measured by make tune or the default of context.h; writes why into reason, together with the multiplication kernel the
+ * products run on
+ */
+enum sqrt2_engine engineChoose(const struct plan *plan, char *reason, size_t size)
+{
+	size_t chosen = 0;
+	for (size_t i = 1; i < ENGINE_COUNT; i++) {
+		if (engines[i].auto_bits <= plan->prec && engines[i].auto_bits >= engines[chosen].auto_bits) {
+			chosen = i;
+		}
+	}
+
+	// The next crossover above the precision bounds the range the chosen engine is the fastest in
+	size_t next = SIZE_MAX;
+	for (size_t i = 0; i < ENGINE_COUNT; i++) {
+		if (engines[i].auto_bits > plan->prec && engines[i].auto_bits < next) {
+			next = engines[i].auto_bits;
+		}
+	}
+
+	const struct kernel *kernel = kernelCurrent();
+	size_t basecase = contextTuning()->mult_basecase != 0 ? contextTuning()->mult_basecase : kernel->basecase;
+	if (next != SIZE_MAX) {
+		snprintf(reason, size, "auto, %zu bits are below the crossover at %zu bits, %s kernel up to %zu blocks", plan->prec, next,
+			kernel->name, basecase);
+	} else {
+		snprintf(reason, size, "auto, %zu bits reach the crossover at %zu bits, %s kernel up to %zu blocks", plan->prec,
+			engines[chosen].auto_bits, kernel->name, basecase);
+	}
+	return engines[chosen].id;
+}
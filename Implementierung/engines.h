@@ -0,0 +1,30 @@
+#ifndef ENGINES_H
+#define ENGINES_H
+
+#include <stddef.h>
+
+#include "libsqrt2.h"
+#include "operations.h"
+#include "plan.h"
+
+/*
+ * An engine computing sqrt2 for a plan: compute returns the result with the working precision of the plan,
+ * auto_bits is the working precision in bits from which SQRT2_ENGINE_AUTO picks it, SIZE_MAX if it never does
+ */
+struct engine {
+	const char *name;
+	const char *description;
+	enum sqrt2_engine id;
+	struct bignum (*compute)(const struct plan *plan);
+	size_t auto_bits;
+};
+
+const struct engine *engineGet(enum sqrt2_engine id);
+
+const struct engine *engineFind(const char *name);
+
+const char *engineNames(void);
+
+enum sqrt2_engine engineChoose(const struct plan *plan, char *reason, size_t size);
+
+#endif
@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "context.h"
+#include "kernels.h"
+#include "estimate.h"
+
+// Smallest time the rounds of one timing take, so that short rounds are not lost in the resolution of the clock
+#define MEASURE_NS 5000000
+
+// Length of the operands of the linear passes, long enough for the loops to dominate and short enough to stay in the cache
+#define LINEAR_BLOCKS 4096
+
+/*
+ * Calls, base case products and their rows and blocks of the operands of karazuba steps of the multiplications of a run
+ */
+struct work {
+	double calls;
+	double products;
+	double rows;
+	double steps;
+};
+
+/*
+ * Rounds timed by estimateMeasure, each one does the work of one unit of its cost on operands of n blocks
+ */
+static void roundLinear(uint32_t *r, const uint32_t *x, size_t n)
+{
+	blocksMul1(r, x, n, 1000000000);
+}
+
+static void roundDivide(uint32_t *r, const uint32_t *x, size_t n)
+{
+	blocksDivrem1(r, x, n, 1000000007);
+}
+
+static void roundPrint(uint32_t *r, const uint32_t *x, size_t n)
+{
+	char text[16];
+	for (size_t i = 0; i < n; i++) {
+		snprintf(text, sizeof(text), "%08x", x[i]);
+		r[i] = text[0];
+	}
+}
+
+/*
+ * Multiplies two different operands of n blocks like the splitting does, above the base case with karazuba steps
+ */
+static void roundProduct(uint32_t *r, const uint32_t *x, size_t n)
+{
+	(void)r;
+	struct bignum a = {(uint32_t *)x, n, 0};
+	struct bignum b = {(uint32_t *)x + 1, n, 0};
+	struct bignum product = karazMult(&a, &b);
+	bignumFree(&product);
+}
+
+static void roundCall(uint32_t *r, const uint32_t *x, size_t n)
+{
+	(void)r;
+	for (size_t i = 0; i < n; i++) {
+		struct bignum a = {(uint32_t *)x + i, 1, 0};
+		struct bignum b = {(uint32_t *)x + (i + 1) % n, 1, 0};
+		struct bignum product = karazMult(&a, &b);
+		bignumFree(&product);
+	}
+}
+
+/*
+ * Returns the nanoseconds one round takes, the median of three timings
+ */
+static double timeRounds(void (*round)(uint32_t *r, const uint32_t *x, size_t n), uint32_t *r, const uint32_t *x, size_t n)
+{
+	double times[3];
+	for (int t = 0; t < 3; t++) {
+		size_t count = 0;
+		uint64_t start = statsNow();
+		uint64_t elapsed;
+		do {
+			round(r, x, n);
+			count++;
+			elapsed = statsNow() - start;
+		} while (elapsed < MEASURE_NS);
+		times[t] = (double)elapsed / count;
+	}
+	double low = times[0] < times[1] ? times[0] : times[1];
+	double high = times[0] < times[1] ? times[1] : times[0];
+	return times[2] < low ? low : times[2] > high ? high : times[2];
+}
+
+/*
+ * Returns the operand length up to which karazMult multiplies directly, like multBasecase
+ */
+static size_t estimateBasecase(void)
+{
+	size_t basecase = contextTuning()->mult_basecase;
+	return basecase != 0 ? basecase : kernelCurrent()->basecase;
+}
+
+/*
+ * Measures the costs of the arithmetic with the selected kernel: the allocations and checks around every multiplication on products
+ * of single blocks, the products at its base case length and at an eighth of it, which separates the cost of a block product from
+ * the cost of starting a row of them, and the karazuba steps on four times the base case
+ */
+void estimateMeasure(struct machine_costs *costs)
+{
+	size_t basecase = estimateBasecase();
+	size_t length = 4 * basecase + 1 > LINEAR_BLOCKS ? 4 * basecase + 1 : LINEAR_BLOCKS;
+	uint32_t *x = malloc(length * sizeof(uint32_t));
+	uint32_t *r = malloc(2 * length * sizeof(uint32_t));
+	if (x == NULL || r == NULL) {
+		free(x);
+		free(r);
+		memset(costs, 0, sizeof(*costs));
+		return;
+	}
+	for (size_t i = 0; i < length; i++) {
+		x[i] = 0x9e3779b9 * (i + 1);
+	}
+
+	// The calls get counted into a sink of their own, they must not show up in the counters of a run on another thread
+	struct stats calibration;
+	memset(&calibration, 0, sizeof(calibration));
+	statsRedirect(&calibration);
+	costs->call_ns = timeRounds(roundCall, r, x, LINEAR_BLOCKS) / LINEAR_BLOCKS;
+	size_t shorter = basecase / 8 > 1 ? basecase / 8 : 1;
+	double full = (timeRounds(roundProduct, r, x, basecase) - costs->call_ns) / basecase;
+	double part = (timeRounds(roundProduct, r, x, shorter) - costs->call_ns) / shorter;
+	// Per row the time is product_ns times the length plus row_ns
+	costs->product_ns = basecase > shorter ? (full - part) / (basecase - shorter) : full / basecase;
+	costs->row_ns = full - costs->product_ns * basecase > 0 ? full - costs->product_ns * basecase : 0;
+	costs->linear_ns = timeRounds(roundLinear, r, x, LINEAR_BLOCKS) / LINEAR_BLOCKS;
+	costs->divide_ns = timeRounds(roundDivide, r, x, LINEAR_BLOCKS) / LINEAR_BLOCKS;
+	costs->print_ns = timeRounds(roundPrint, r, x, LINEAR_BLOCKS) / LINEAR_BLOCKS;
+
+	// Two karazuba steps over 4 and 2 times the base case make 9 products of the base case on 10 times the base case in blocks
+	double steps = timeRounds(roundProduct, r, x, 4 * basecase) - 13 * costs->call_ns
+		- 9 * basecase * (basecase * costs->product_ns + costs->row_ns);
+	costs->step_ns = steps > 0 ? steps / (10.0 * basecase) : 0;
+	statsRedirect(NULL);
+
+	free(x);
+	free(r);
+}
+
+/*
+ * Sets the costs written by make tune, or the defaults of context.h without them, so that predictions do not depend on the noise of
+ * measuring at the start of every run
+ */
+void estimateCosts(struct machine_costs *costs)
+{
+	costs->product_ns = TUNING_PRODUCT_PS * 1e-3;
+	costs->row_ns = TUNING_ROW_PS * 1e-3;
+	costs->step_ns = TUNING_STEP_PS * 1e-3;
+	costs->linear_ns = TUNING_LINEAR_PS * 1e-3;
+	costs->divide_ns = TUNING_DIVIDE_PS * 1e-3;
+	costs->print_ns = TUNING_PRINT_PS * 1e-3;
+	costs->call_ns = TUNING_CALL_PS * 1e-3;
+}
+
+/*
+ * Adds the work of count karazMult calls on two operands of blocks blocks: every karazuba step above the base case makes three
+ * products of half the length and works on all blocks of the operands, the base case multiplies all blocks with each other
+ */
+static void multWork(struct work *work, double blocks, double count, size_t basecase)
+{
+	blocks = blocks < 1 ? 1 : blocks;
+	while (blocks > basecase) {
+		work->calls += count;
+		work->steps += blocks * count;
+		blocks /= 2;
+		count *= 3;
+	}
+	work->calls += count;
+	work->products += blocks * blocks * count;
+	work->rows += blocks * count;
+}
+
+/*
+ * Number of merges on the level of a splitting tree whose nodes span terms terms, count of them: a tree over a fractional number
+ * of terms between one and two only merges that fraction of its nodes, so that a tree over k leaves makes k - 1 merges in total
+ */
+static double levelMerges(double terms, double count)
+{
+	return terms >= 2 ? count : count * (terms - 1);
+}
+
+/*
+ * Adds the work of a product tree over terms terms like Q(n1, n2) or P(n1, n2), count times; every node multiplies its halves
+ * Every term adds bits bits to the product
+ */
+static void productTree(struct work *work, double terms, double count, double bits, size_t basecase)
+{
+	for (; terms > 1; terms /= 2, count *= 2) {
+		multWork(work, terms / 2 * bits / 32, levelMerges(terms, count), basecase);
+	}
+}
+
+static double workSeconds(const struct work *work, const struct machine_costs *costs)
+{
+	return (work->products * costs->product_ns + work->rows * costs->row_ns + work->steps * costs->step_ns + work->calls * costs->call_ns) * 1e-9;
+}
+
+static void workAdd(struct work *sum, const struct work *work)
+{
+	sum->calls += work->calls;
+	sum->products += work->products;
+	sum->rows += work->rows;
+	sum->steps += work->steps;
+}
+
+/*
+ * Predicts the run of the plan with the given engine, threads and worker processes from the sizes the operands grow to in the
+ * splitting tree, the karazuba steps of their products and the costs of the arithmetic on this machine
+ * Q(n1, n2) is the product of 4i over its terms, which adds log2(4n) - 1 / ln(2) bits per term on average; P and T grow alike
+ */
+void estimateRun(struct estimate *estimate, const struct plan *plan, enum sqrt2_engine engine, size_t threads, size_t processes,
+	const struct machine_costs *costs)
+{
+	memset(estimate, 0, sizeof(*estimate));
+	size_t basecase = estimateBasecase();
+	double n = plan->terms;
+	double bits = log2(4 * n) - 1 / log(2);
+	double blocks = plan->prec / 32 + 1;
+	struct work total = {0, 0, 0, 0};
+
+	if (engine == SQRT2_ENGINE_SERIES) {
+		// Every term is multiplied, divided and added over the blocks it still has, which fall from the full length to none
+		double len = blocks + 1;
+		estimate->phase_seconds[PHASE_SERIES] = (n * len * costs->linear_ns + n * len / 2 * costs->divide_ns) * 1e-9;
+	} else if (engine == SQRT2_ENGINE_SPLIT) {
+		// T(n1, n2) computes Q of its right half and P of its left half again, and accumulates two products into its merge
+		struct work work = {0, 0, 0, 0};
+		double count = 1;
+		for (double terms = n - 1; terms > 1; terms /= 2, count *= 2) {
+			productTree(&work, terms / 2, 2 * levelMerges(terms, count), bits, basecase);
+			multWork(&work, terms / 2 * bits / 32, 2 * levelMerges(terms, count), basecase);
+		}
+		productTree(&work, n - 1, 1, bits, basecase);
+		estimate->phase_seconds[PHASE_SPLIT] = workSeconds(&work, costs);
+		workAdd(&total, &work);
+	} else {
+		// Every merge makes four products of operands cut to the kept blocks; the subtrees of a level are computed at once by up
+		// to one thread or worker process each, limited by the processors
+		long processors = sysconf(_SC_NPROCESSORS_ONLN);
+		double workers = (double)threads * processes;
+		if (processors > 0 && workers > processors) {
+			workers = processors;
+		}
+		double keep = blocks + 2;
+		double count = 1;
+		for (double terms = n - 1; terms > 1; terms /= 2, count *= 2) {
+			struct work work = {0, 0, 0, 0};
+			double length = terms / 2 * bits / 32;
+			multWork(&work, length < keep ? length : keep, 4 * levelMerges(terms, count), basecase);
+			double parallel = count < workers ? count : workers;
+			estimate->phase_seconds[PHASE_SPLIT] += workSeconds(&work, costs) / parallel;
+			workAdd(&total, &work);
+		}
+	}
+
+	if (engine != SQRT2_ENGINE_SERIES) {
+		// Every Newton step makes two products at twice the considered blocks, the start value and the quotient one more each
+		int steps = ceil(log2((plan->prec + 1) / log2(17)));
+		struct work work = {0, 0, 0, 0};
+		multWork(&work, 2 * blocks, 2 * steps + 2, basecase);
+		estimate->phase_seconds[PHASE_DIVISION] = workSeconds(&work, costs);
+		workAdd(&total, &work);
+	}
+
+	// Hexadecimal places are printed block by block, every group of nine decimal places multiplies the remaining blocks by 10^9
+	double groups = plan->base == 16 ? blocks : plan->digits / 9.0;
+	double passes = plan->base == 16 ? 0 : groups * blocks / 2;
+	estimate->phase_seconds[PHASE_OUTPUT] = (groups * costs->print_ns + passes * costs->linear_ns) * 1e-9;
+
+	for (size_t i = 0; i < PHASE_COUNT; i++) {
+		estimate->seconds += estimate->phase_seconds[i];
+	}
+	estimate->bytes = planMemory(plan, engine, threads);
+	estimate->mult_calls = total.calls;
+	estimate->products = total.products;
+}
+
+/*
+ * Prints the predicted time of every phase the run goes through, its memory and multiplication work, and the costs it is based on
+ */
+void estimatePrint(FILE *stream, const struct estimate *estimate, const struct machine_costs *costs)
+{
+	for (size_t i = 0; i < PHASE_COUNT; i++) {
+		if (estimate->phase_seconds[i] > 0) {
+			fprintf(stream, "  %-16s %12.3f s\n", phase_names[i], estimate->phase_seconds[i]);
+		}
+	}
+	fprintf(stream, "  %-16s %12.3f s\n", "total", estimate->seconds);
+	fprintf(stream, "  %-16s %12.1f MiB\n", "peak live", estimate->bytes / 1048576.0);
+	fprintf(stream, "  %-16s %12.0f\n", "karazMult calls", estimate->mult_calls);
+	fprintf(stream, "  %-16s %12.0f\n", "block products", estimate->products);
+	fprintf(stream, "Costs per block: product %.3f ns, linear pass %.3f ns, division %.3f ns, printing %.3f ns\n", costs->product_ns,
+		costs->linear_ns, costs->divide_ns, costs->print_ns);
+	fprintf(stream, "Costs per block of a karazuba step %.3f ns, per base case row %.1f ns, per karazMult call %.1f ns\n", costs->step_ns,
+		costs->row_ns, costs->call_ns);
+}
+
+static void compareLine(FILE *stream, const char *name, double predicted, double actual, int decimals, const char *unit)
+{
+	fprintf(stream, "  %-16s %12.*f %12.*f %-4s", name, decimals, predicted, decimals, actual, unit);
+	if (predicted > 0) {
+		fprintf(stream, " %8.2f", actual / predicted);
+	}
+	fprintf(stream, "\n");
+}
+
+/*
+ * Prints the prediction next to the figures stats measured in the run; the verification is not predicted and left out of the total
+ * The memory estimate is meant as bound for the live blocks; the resident set adds the program, the allocator and the pages of
+ * freed blocks it keeps, so it is only shown as measured
+ */
+void estimateCompare(FILE *stream, const struct estimate *estimate)
+{
+	fprintf(stream, "Estimate               predicted       actual      actual/predicted\n");
+	double actual_total = 0;
+	for (size_t i = 0; i < PHASE_COUNT; i++) {
+		if (i == PHASE_VERIFY) {
+			continue;
+		}
+		double actual = stats.phase_ns[i] * 1e-9;
+		actual_total += actual;
+		if (estimate->phase_seconds[i] > 0 || actual > 0) {
+			compareLine(stream, phase_names[i], estimate->phase_seconds[i], actual, 3, "s");
+		}
+	}
+	compareLine(stream, "total", estimate->seconds, actual_total, 3, "s");
+	compareLine(stream, "peak live", estimate->bytes / 1048576.0, stats.peak_bytes / 1048576.0, 1, "MiB");
+	fprintf(stream, "  %-16s %12s %12.1f %-4s\n", "peak rss", "-", statsPeakRss() / 1048576.0, "MiB");
+	compareLine(stream, "karazMult calls", estimate->mult_calls, stats.calls[OP_MULT], 0, "");
+	compareLine(stream, "block products", estimate->products, stats.products, 0, "");
+}
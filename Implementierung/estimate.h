@@ -0,0 +1,49 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "libsqrt2.h"
+#include "plan.h"
+#include "stats.h"
+
+/*
+ * Costs of the arithmetic on this machine in nanoseconds: one block product of the base case multiplication and one of its rows,
+ * one block of the operands of a karazuba step, one block of a linear pass like a multiplication by one block, one block of a
+ * division by one block, one printed group of places and the allocations and checks around every karazMult call
+ */
+struct machine_costs {
+	double product_ns;
+	double row_ns;
+	double step_ns;
+	double linear_ns;
+	double divide_ns;
+	double print_ns;
+	double call_ns;
+};
+
+/*
+ * Predicted run of a plan: wall time per phase, the most memory held at once and the multiplication work, counted like the
+ * counters of stats in karazMult calls and in block products of the base case
+ */
+struct estimate {
+	double phase_seconds[PHASE_COUNT];
+	double seconds;
+	size_t bytes;
+	double mult_calls;
+	double products;
+};
+
+void estimateMeasure(struct machine_costs *costs);
+
+void estimateCosts(struct machine_costs *costs);
+
+void estimateRun(struct estimate *estimate, const struct plan *plan, enum sqrt2_engine engine, size_t threads, size_t processes,
+	const struct machine_costs *costs);
+
+void estimatePrint(FILE *stream, const struct estimate *estimate, const struct machine_costs *costs);
+
+void estimateCompare(FILE *stream, const struct estimate *estimate);
+
+#endif
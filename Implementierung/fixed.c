@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include "context.h"
+#include "fixed.h"
+#include "stats.h"
+
+/*
+ * Returns a fixed point number of length zeroed blocks with exponent exp
+ */
+struct fixed fixedAlloc(size_t length, long exp)
+{
+	struct fixed res;
+	res.limbs = limbsAlloc(length);
+	res.offset = 0;
+	res.length = length;
+	res.capacity = length;
+	res.exp = exp;
+	return res;
+}
+
+/*
+ * Returns the mantissa of x as integer bignum for karazMult, which only reads it
+ */
+static struct bignum fixedMantissa(const struct fixed *x)
+{
+	struct bignum view = {x->limbs + x->offset, x->length, 0};
+	return view;
+}
+
+/*
+ * Removes leading zero blocks of the mantissa, at least one block stays
+ */
+static void fixedNormalize(struct fixed *x)
+{
+	while (x->length > 1 && x->limbs[x->offset + x->length - 1] == 0) {
+		x->length--;
+	}
+}
+
+/*
+ * Turns the bignum into a fixed point number without copying its blocks, x must not be used afterwards
+ */
+struct fixed fixedTake(struct bignum *x)
+{
+	struct fixed res;
+	res.limbs = x->numbers;
+	res.offset = 0;
+	res.length = x->length;
+	res.capacity = x->length;
+	res.exp = -(long)x->subone;
+	x->numbers = NULL;
+	return res;
+}
+
+/*
+ * Returns a fixed point number reading the blocks of x; it must neither be freed nor truncated to nothing, x has to outlive it
+ */
+struct fixed fixedView(const struct bignum *x)
+{
+	struct fixed res;
+	res.limbs = x->numbers;
+	res.offset = 0;
+	res.length = x->length;
+	res.capacity = x->length;
+	res.exp = -(long)x->subone;
+	return res;
+}
+
+/*
+ * Returns a fixed point number with the value of x, which stays unchanged
+ */
+struct fixed fixedCopy(const struct bignum *x)
+{
+	struct fixed res = fixedAlloc(x->length, -(long)x->subone);
+	memcpy(res.limbs, x->numbers, x->length * sizeof(uint32_t));
+	return res;
+}
+
+/*
+ * Returns the integer value as fixed point number
+ */
+struct fixed fixedInt(uint32_t value)
+{
+	struct fixed res = fixedAlloc(1, 0);
+	res.limbs[0] = value;
+	return res;
+}
+
+/*
+ * Turns x back into a bignum with the same value; this is where the blocks get aligned to the comma again, the mantissa moves to
+ * the start of the allocation and gets zero extended up to the comma
+ */
+struct bignum fixedRelease(struct fixed *x)
+{
+	// Integers with a positive exponent get the zero blocks below their mantissa
+	size_t shift = x->exp > 0 ? (size_t)x->exp : 0;
+	size_t subone = x->exp < 0 ? (size_t)-x->exp : 0;
+	size_t length = x->length + shift > subone ? x->length + shift : subone;
+
+	if (length + 1 > x->capacity) {
+		x->limbs = limbsRealloc(x->limbs, length + 1);
+		x->capacity = length + 1;
+	}
+	memmove(x->limbs + shift, x->limbs + x->offset, x->length * sizeof(uint32_t));
+	memset(x->limbs, 0, shift * sizeof(uint32_t));
+	memset(x->limbs + shift + x->length, 0, (x->capacity - shift - x->length) * sizeof(uint32_t));
+
+	struct bignum res = {x->limbs, length, subone};
+	x->limbs = NULL;
+	return res;
+}
+
+void fixedFree(struct fixed *x)
+{
+	limbsFree(x->limbs);
+	x->limbs = NULL;
+}
+
+/*
+ * Drops the blocks of x below 2^(32 * exp) by moving the start of the mantissa, the blocks stay allocated until x gets freed
+ */
+void fixedTruncate(struct fixed *x, long exp)
+{
+	if (x->exp >= exp) {
+		return;
+	}
+
+	size_t drop = exp - x->exp;
+	if (drop >= x->length) {
+		// Nothing is left, zero keeps one block
+		x->offset += x->length - 1;
+		x->limbs[x->offset] = 0;
+		x->length = 1;
+	} else {
+		x->offset += drop;
+		x->length -= drop;
+	}
+	x->exp = exp;
+}
+
+/*
+ * Multiplies the mantissas with karazMult and adds the exponents; the operands get passed as integer views without aligning their
+ * exponents first, but above the base case karazMult still copies and pads both to an even common length for its karazuba steps
+ */
+struct fixed fixedMul(const struct fixed *x, const struct fixed *y)
+{
+	struct bignum mx = fixedMantissa(x);
+	struct bignum my = fixedMantissa(y);
+	// The same view twice lets karazMult take the square path
+	struct bignum product = karazMult(&mx, x == y ? &mx : &my);
+
+	struct fixed res = fixedTake(&product);
+	res.exp = x->exp + y->exp;
+	fixedNormalize(&res);
+	return res;
+}
+
+/*
+ * Adds y to x, or subtracts y from x, block by block after aligning both to the lower exponent
+ * Zero blocks at the bottom of the result get dropped like the zero subone blocks in bignumAdd and bignumSub
+ */
+static struct fixed fixedCombine(const struct fixed *x, const struct fixed *y, bool subtract)
+{
+	long exp = x->exp < y->exp ? x->exp : y->exp;
+	long x_top = x->exp + (long)x->length;
+	long y_top = y->exp + (long)y->length;
+	size_t length = (x_top > y_top ? x_top : y_top) - exp + 1;
+	statsOp(subtract ? OP_SUB : OP_ADD, length);
+
+	struct fixed res = fixedAlloc(length, exp);
+	uint32_t *r = res.limbs;
+	memcpy(r + (x->exp - exp), x->limbs + x->offset, x->length * sizeof(uint32_t));
+
+	const uint32_t *b = y->limbs + y->offset;
+	size_t pos = y->exp - exp;
+	uint64_t carry = 0;
+	for (size_t i = 0; i < y->length || (carry != 0 && pos + i < length); i++) {
+		uint64_t value = i < y->length ? b[i] : 0;
+		if (subtract) {
+			uint64_t diff = (uint64_t)r[pos + i] - value - carry;
+			r[pos + i] = (uint32_t)diff;
+			carry = diff >> 63;
+		} else {
+			uint64_t sum = (uint64_t)r[pos + i] + value + carry;
+			r[pos + i] = (uint32_t)sum;
+			carry = sum >> 32;
+		}
+	}
+	if (subtract && carry != 0) {
+		contextFail(SQRT2_EINTERNAL, "DEBUG: fixedSub cannot subtract a greater number!\n");
+	}
+
+	fixedNormalize(&res);
+	while (res.length > 1 && res.limbs[res.offset] == 0) {
+		res.offset++;
+		res.length--;
+		res.exp++;
+	}
+	return res;
+}
+
+struct fixed fixedAdd(const struct fixed *x, const struct fixed *y)
+{
+	return fixedCombine(x, y, false);
+}
+
+/*
+ * Subtracts y from x, which has to be at least as great as y
+ */
+struct fixed fixedSub(const struct fixed *x, const struct fixed *y)
+{
+	return fixedCombine(x, y, true);
+}
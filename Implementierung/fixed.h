@@ -0,0 +1,45 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "operations.h"
+
+/*
+ * Fixed point number mantissa * 2^(32 * exp), the mantissa is the integer in the length blocks starting at limbs + offset
+ * limbs is the allocation of capacity blocks; dropping low blocks only moves offset, products only add the exponents, so blocks
+ * get aligned to each other only when adding or subtracting
+ */
+struct fixed {
+	uint32_t *limbs;
+	size_t offset;
+	size_t length;
+	size_t capacity;
+	long exp;
+};
+
+struct fixed fixedAlloc(size_t length, long exp);
+
+struct fixed fixedTake(struct bignum *x);
+
+struct fixed fixedView(const struct bignum *x);
+
+struct fixed fixedCopy(const struct bignum *x);
+
+struct fixed fixedInt(uint32_t value);
+
+struct bignum fixedRelease(struct fixed *x);
+
+void fixedFree(struct fixed *x);
+
+void fixedTruncate(struct fixed *x, long exp);
+
+struct fixed fixedMul(const struct fixed *x, const struct fixed *y);
+
+struct fixed fixedAdd(const struct fixed *x, const struct fixed *y);
+
+struct fixed fixedSub(const struct fixed *x, const struct fixed *y);
+
+#endif
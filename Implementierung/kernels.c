@@ -0,0 +1,261 @@
+#include <cpuid.h>
+#include <immintrin.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "context.h"
+#include "kernels.h"
+#include "operations.h"
+
+#define MASK52 ((UINT64_C(1) << 52) - 1)
+
+// Below this length of the shorter operand the setup of the vector kernels costs more than they save
+#define VECTOR_MIN 16
+
+/*
+ * Returns the state components the operating system saves on a context switch, bit 1 and 2 for the xmm and ymm registers
+ * and bit 5 to 7 for the AVX-512 registers
+ */
+static uint64_t xgetbv0(void)
+{
+	uint32_t lo, hi;
+	__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (uint64_t)hi << 32 | lo;
+}
+
+static bool scalarSupported(void)
+{
+	return true;
+}
+
+static bool avx2Supported(void)
+{
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_OSXSAVE) || !(c & bit_AVX) || (xgetbv0() & 0x6) != 0x6) {
+		return false;
+	}
+	return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2);
+}
+
+static bool ifmaSupported(void)
+{
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_OSXSAVE) || (xgetbv0() & 0xe6) != 0xe6) {
+		return false;
+	}
+	return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX512F) && (b & bit_AVX512IFMA);
+}
+
+/*
+ * One row per block of the shorter operand, the rows are summed up by blocksAddmul1
+ */
+static void scalarMult(uint32_t *r, const uint32_t *x, size_t n, const uint32_t *y, size_t m)
+{
+	if (n > m) {
+		const uint32_t *swap = x;
+		x = y;
+		y = swap;
+		size_t len = n;
+		n = m;
+		m = len;
+	}
+	for (size_t i = 0; i < n; i++) {
+		r[i + m] = blocksAddmul1(r + i, y, m, x[i]);
+	}
+}
+
+/*
+ * Four block products at once with vpmuludq: the low halves of the 64 bit products are summed up per column in lo and the high
+ * halves in hi, so no carry has to be propagated until the single normalization pass at the end. Every column gets at most
+ * min(n, m) summands below 2^32, so the 64 bit lanes cannot overflow
+ */
+__attribute__((target("avx2")))
+static void avx2Mult(uint32_t *r, const uint32_t *x, size_t n, const uint32_t *y, size_t m)
+{
+	if (n < VECTOR_MIN || m < VECTOR_MIN) {
+		scalarMult(r, x, n, y, m);
+		return;
+	}
+
+	// y gets zero extended to 64 bit lanes and padded to a multiple of four
+	size_t padded = (m + 3) & ~(size_t)3;
+	uint64_t *wide = contextAlloc(padded * sizeof(uint64_t));
+	uint64_t *lo = contextAlloc((n + padded) * sizeof(uint64_t));
+	uint64_t *hi = contextAlloc((n + padded) * sizeof(uint64_t));
+	for (size_t j = 0; j < m; j++) {
+		wide[j] = y[j];
+	}
+
+	const __m256i mask = _mm256_set1_epi64x(0xffffffff);
+	for (size_t i = 0; i < n; i++) {
+		__m256i xi = _mm256_set1_epi64x(x[i]);
+		for (size_t j = 0; j < padded; j += 4) {
+			__m256i p = _mm256_mul_epu32(xi, _mm256_loadu_si256((const __m256i *)(wide + j)));
+			__m256i *l = (__m256i *)(lo + i + j);
+			__m256i *h = (__m256i *)(hi + i + j);
+			_mm256_storeu_si256(l, _mm256_add_epi64(_mm256_loadu_si256(l), _mm256_and_si256(p, mask)));
+			_mm256_storeu_si256(h, _mm256_add_epi64(_mm256_loadu_si256(h), _mm256_srli_epi64(p, 32)));
+		}
+	}
+
+	// Column k holds the low halves of its own products and the high halves of the column below
+	uint64_t carry = 0;
+	for (size_t k = 0; k < n + m; k++) {
+		uint64_t sum = lo[k] + (k > 0 ? hi[k - 1] : 0) + carry;
+		r[k] = (uint32_t)sum;
+		carry = sum >> 32;
+	}
+
+	contextFree(hi);
+	contextFree(lo);
+	contextFree(wide);
+}
+
+/*
+ * Stores the count 52 bit digits of the n blocks in x, the highest digit takes the bits that are left
+ */
+static void toRadix52(uint64_t *digits, size_t count, const uint32_t *x, size_t n)
+{
+	for (size_t k = 0; k < count; k++) {
+		size_t block = 52 * k / 32;
+		unsigned int shift = 52 * k % 32;
+		uint64_t window = x[block];
+		if (block + 1 < n) {
+			window |= (uint64_t)x[block + 1] << 32;
+		}
+		window >>= shift;
+		if (shift > 12 && block + 2 < n) {
+			window |= (uint64_t)x[block + 2] << (64 - shift);
+		}
+		digits[k] = window & MASK52;
+	}
+}
+
+/*
+ * Stores the n blocks of the count normalized 52 bit digits in r
+ */
+static void fromRadix52(uint32_t *r, size_t n, const uint64_t *digits, size_t count)
+{
+	for (size_t k = 0; k < n; k++) {
+		size_t digit = 32 * k / 52;
+		unsigned int shift = 32 * k % 52;
+		uint64_t window = digits[digit] >> shift;
+		if (shift > 20 && digit + 1 < count) {
+			window |= digits[digit + 1] << (52 - shift);
+		}
+		r[k] = (uint32_t)window;
+	}
+}
+
+/*
+ * Eight digit products at once with the AVX-512 IFMA instructions in radix 2^52: vpmadd52luq and vpmadd52huq add the low and the
+ * high 52 bits of the 104 bit products to the column sums lo and hi, which get normalized once at the end. The column sums stay
+ * below 2^62 as long as the shorter operand has at most 1024 digits, longer ones take the AVX2 kernel
+ */
+__attribute__((target("avx512f,avx512ifma")))
+static void ifmaMult(uint32_t *r, const uint32_t *x, size_t n, const uint32_t *y, size_t m)
+{
+	if (n < VECTOR_MIN || m < VECTOR_MIN) {
+		scalarMult(r, x, n, y, m);
+		return;
+	}
+
+	size_t xn = (32 * n + 51) / 52;
+	size_t yn = (32 * m + 51) / 52;
+	if (xn > 1024 && yn > 1024) {
+		avx2Mult(r, x, n, y, m);
+		return;
+	}
+
+	size_t padded = (yn + 7) & ~(size_t)7;
+	uint64_t *xd = contextAlloc(xn * sizeof(uint64_t));
+	uint64_t *yd = contextAlloc(padded * sizeof(uint64_t));
+	uint64_t *lo = contextAlloc((xn + padded + 1) * sizeof(uint64_t));
+	uint64_t *hi = contextAlloc((xn + padded) * sizeof(uint64_t));
+	toRadix52(xd, xn, x, n);
+	toRadix52(yd, yn, y, m);
+
+	for (size_t i = 0; i < xn; i++) {
+		__m512i xi = _mm512_set1_epi64(xd[i]);
+		for (size_t j = 0; j < padded; j += 8) {
+			__m512i yj = _mm512_loadu_si512(yd + j);
+			_mm512_storeu_si512(lo + i + j, _mm512_madd52lo_epu64(_mm512_loadu_si512(lo + i + j), xi, yj));
+			_mm512_storeu_si512(hi + i + j, _mm512_madd52hi_epu64(_mm512_loadu_si512(hi + i + j), xi, yj));
+		}
+	}
+
+	// Normalizing the columns to 52 bit digits in place of lo
+	uint64_t carry = 0;
+	for (size_t k = 0; k < xn + yn; k++) {
+		uint64_t sum = lo[k] + (k > 0 ? hi[k - 1] : 0) + carry;
+		lo[k] = sum & MASK52;
+		carry = sum >> 52;
+	}
+	fromRadix52(r, n + m, lo, xn + yn);
+
+	contextFree(hi);
+	contextFree(lo);
+	contextFree(yd);
+	contextFree(xd);
+}
+
+// Ordered from the slowest to the fastest kernel
+static const struct kernel kernels[] = {
+	{"scalar", scalarMult, scalarSupported, TUNING_BASECASE_SCALAR, false},
+	{"avx2", avx2Mult, avx2Supported, TUNING_BASECASE_AVX2, true},
+	{"ifma", ifmaMult, ifmaSupported, TUNING_BASECASE_IFMA, true},
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+static const struct kernel *current;
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Picks the fastest kernel the processor supports, done once on the first use
+ */
+static void kernelDetect(void)
+{
+	for (size_t i = KERNEL_COUNT; i-- > 0;) {
+		if (kernels[i].supported()) {
+			__atomic_store_n(&current, &kernels[i], __ATOMIC_RELEASE);
+			return;
+		}
+	}
+}
+
+/*
+ * Returns the kernel basecaseMult uses
+ */
+const struct kernel *kernelCurrent(void)
+{
+	pthread_once(&detect_once, kernelDetect);
+	return __atomic_load_n(&current, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Replaces the detected kernel by the one with the given name for all threads; fails if there is none or if the processor cannot
+ * run it
+ */
+bool kernelSelect(const char *name)
+{
+	pthread_once(&detect_once, kernelDetect);
+	for (size_t i = 0; i < KERNEL_COUNT; i++) {
+		if (strcmp(kernels[i].name, name) == 0) {
+			if (!kernels[i].supported()) {
+				return false;
+			}
+			__atomic_store_n(&current, &kernels[i], __ATOMIC_RELEASE);
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Returns the names of all kernels for usage messages
+ */
+const char *kernelNames(void)
+{
+	return "scalar, avx2, ifma";
+}
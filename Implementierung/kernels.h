@@ -0,0 +1,28 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A base case multiplication kernel: mult stores the n + m blocks of the product of x (n blocks) and y (m blocks) in the
+ * zeroed blocks of r; supported tells whether the processor and the operating system can run it
+ * basecase is the operand length up to which the kernel beats a karazuba step, vector is set for the kernels that outrun the
+ * scalar square and multiply-add rows
+ */
+struct kernel {
+	const char *name;
+	void (*mult)(uint32_t *r, const uint32_t *x, size_t n, const uint32_t *y, size_t m);
+	bool (*supported)(void);
+	size_t basecase;
+	bool vector;
+};
+
+const struct kernel *kernelCurrent(void);
+
+bool kernelSelect(const char *name);
+
+const char *kernelNames(void);
+
+#endif
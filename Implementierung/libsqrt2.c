@@ -0,0 +1,943 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "context.h"
+#include "sqrt2.h"
+#include "plan.h"
+#include "stats.h"
+#include "pages.h"
+#include "distribute.h"
+#include "engines.h"
+#include "cache.h"
+
+const struct sqrt2_tuning default_tuning = {
+	.mult_basecase = 0,
+	.parallel_grain = TUNING_PARALLEL_GRAIN,
+};
+
+// Library call running on this thread, NULL outside of library calls
+__thread struct tracker *current_tracker = NULL;
+
+/*
+ * Links the allocation into the list of the running library call
+ */
+void trackLink(struct alloc_header *header)
+{
+	struct tracker *tracker = current_tracker;
+	if (tracker == NULL) {
+		header->prev = NULL;
+		header->next = NULL;
+		return;
+	}
+	header->next = &tracker->list;
+	header->prev = tracker->list.prev;
+	tracker->list.prev->next = header;
+	tracker->list.prev = header;
+	__atomic_add_fetch(&tracker->ctx->live_bytes, sizeof(struct alloc_header) + header->bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Removes the allocation from the list of the running library call, linked allocations are only freed during the call
+ */
+void trackUnlink(struct alloc_header *header)
+{
+	if (header->prev != NULL) {
+		header->prev->next = header->next;
+		header->next->prev = header->prev;
+		header->prev = NULL;
+		header->next = NULL;
+		__atomic_sub_fetch(&current_tracker->ctx->live_bytes, sizeof(struct alloc_header) + header->bytes, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Fails the running library call with SQRT2_ENOMEM if allocating bytes more would exceed the memory budget of its context
+ */
+static void trackCharge(size_t bytes)
+{
+	struct tracker *tracker = current_tracker;
+	if (tracker == NULL || tracker->ctx->max_bytes == 0) {
+		return;
+	}
+	if (__atomic_load_n(&tracker->ctx->live_bytes, __ATOMIC_RELAXED) + bytes > tracker->ctx->max_bytes) {
+		contextFail(SQRT2_ENOMEM, "Error: memory budget exceeded!");
+	}
+}
+
+void *defaultAlloc(size_t bytes, void *opaque);
+
+// Allocator of the blocks that got a mapping of their own, they bypass the allocator of the context
+static const struct sqrt2_allocator mapped_allocator;
+
+/*
+ * Tells whether allocations of the running library call may get mappings with huge pages: only if its context uses the default
+ * allocator with huge pages enabled; allocations outside of library calls may always
+ */
+static bool contextMaps(void)
+{
+	struct tracker *tracker = current_tracker;
+	return tracker == NULL || (tracker->ctx->allocator.alloc == defaultAlloc && tracker->ctx->huge_pages);
+}
+
+/*
+ * Returns the NUMA placement of the running library call
+ */
+static enum sqrt2_numa contextNuma(void)
+{
+	return current_tracker != NULL ? current_tracker->ctx->numa : SQRT2_NUMA_DEFAULT;
+}
+
+/*
+ * Allocates bytes of zeroed memory with the allocator of the running library call, or with malloc outside of library calls
+ * Large allocations get mapped directly with huge pages, see contextMaps
+ * Fails the running call with SQRT2_ENOMEM if there is not enough memory
+ */
+void *contextAlloc(size_t bytes)
+{
+	const struct sqrt2_allocator *allocator = current_tracker != NULL ? &current_tracker->ctx->allocator : NULL;
+	struct alloc_header *header;
+	bool maps = contextMaps();
+	enum sqrt2_numa numa = contextNuma();
+
+	trackCharge(sizeof(struct alloc_header) + bytes);
+
+	if (maps && sizeof(struct alloc_header) + bytes >= PAGES_MAP_MIN) {
+		header = pagesMap(sizeof(struct alloc_header) + bytes, numa);
+		allocator = &mapped_allocator;
+	} else if (allocator != NULL) {
+		header = allocator->alloc(sizeof(struct alloc_header) + bytes, allocator->opaque);
+	} else {
+		header = malloc(sizeof(struct alloc_header) + bytes);
+	}
+	if (header == NULL) {
+		contextFail(SQRT2_ENOMEM, "Error while allocation memory!");
+	}
+
+	// New mappings are zeroed already, touching them here would also place every page on the node of this thread
+	if (allocator != &mapped_allocator) {
+		memset(header + 1, 0, bytes);
+	}
+	header->bytes = bytes;
+	header->allocator = allocator;
+	header->maps = maps;
+	header->numa = numa;
+	trackLink(header);
+	return header + 1;
+}
+
+/*
+ * Resizes memory allocated with contextAlloc; the added bytes are not initialized
+ */
+void *contextRealloc(void *ptr, size_t bytes)
+{
+	if (ptr == NULL) {
+		return contextAlloc(bytes);
+	}
+
+	struct alloc_header *header = (struct alloc_header *)ptr - 1;
+	const struct sqrt2_allocator *allocator = header->allocator;
+	bool linked = header->prev != NULL;
+	if (bytes > header->bytes) {
+		trackCharge(bytes - header->bytes);
+	}
+	trackUnlink(header);
+
+	struct alloc_header *resized;
+	if (allocator == &mapped_allocator) {
+		resized = pagesRemap(header, sizeof(struct alloc_header) + header->bytes, sizeof(struct alloc_header) + bytes, header->numa);
+	} else if (header->maps && sizeof(struct alloc_header) + bytes >= PAGES_MAP_MIN) {
+		// Growing past the threshold moves the blocks into a mapping of their own
+		resized = pagesMap(sizeof(struct alloc_header) + bytes, header->numa);
+		if (resized != NULL) {
+			memcpy(resized, header, sizeof(struct alloc_header) + (header->bytes < bytes ? header->bytes : bytes));
+			resized->allocator = &mapped_allocator;
+			if (allocator != NULL) {
+				allocator->free(header, allocator->opaque);
+			} else {
+				free(header);
+			}
+		}
+	} else if (allocator != NULL) {
+		resized = allocator->realloc(header, sizeof(struct alloc_header) + bytes, allocator->opaque);
+	} else {
+		resized = realloc(header, sizeof(struct alloc_header) + bytes);
+	}
+	if (resized == NULL) {
+		// The old memory is still valid and has to be freed with the failing call
+		if (linked) {
+			trackLink(header);
+		}
+		contextFail(SQRT2_ENOMEM, "Error while allocation memory!");
+	}
+
+	resized->bytes = bytes;
+	if (linked) {
+		trackLink(resized);
+	}
+	return resized + 1;
+}
+
+/*
+ * Frees memory allocated with contextAlloc
+ */
+void contextFree(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	struct alloc_header *header = (struct alloc_header *)ptr - 1;
+	trackUnlink(header);
+	if (header->allocator == &mapped_allocator) {
+		pagesUnmap(header, sizeof(struct alloc_header) + header->bytes);
+	} else if (header->allocator != NULL) {
+		header->allocator->free(header, header->allocator->opaque);
+	} else {
+		free(header);
+	}
+}
+
+/*
+ * Fails the running library call with status; outside of library calls the message gets printed and the program terminates
+ */
+void contextFail(int status, const char *message)
+{
+	struct tracker *tracker = current_tracker;
+	if (tracker == NULL) {
+		fprintf(stderr, "%s", message);
+		exit(EXIT_FAILURE);
+	}
+	tracker->status = status;
+	longjmp(tracker->jump, 1);
+}
+
+/*
+ * Returns the context of the running library call, NULL outside of library calls
+ */
+struct sqrt2_ctx *contextCurrent(void)
+{
+	return current_tracker != NULL ? current_tracker->ctx : NULL;
+}
+
+/*
+ * Returns the thresholds of the running library call, the defaults outside of library calls
+ */
+const struct sqrt2_tuning *contextTuning(void)
+{
+	return current_tracker != NULL ? &current_tracker->ctx->tuning : &default_tuning;
+}
+
+/*
+ * Starts tracking the allocations of a library call on the calling thread; the caller has to setjmp on tracker->jump right after
+ */
+void trackerBegin(struct tracker *tracker, struct sqrt2_ctx *ctx)
+{
+	tracker->ctx = ctx;
+	tracker->list.prev = &tracker->list;
+	tracker->list.next = &tracker->list;
+	tracker->outer = current_tracker;
+	tracker->status = SQRT2_OK;
+	if (current_tracker != NULL) {
+		tracker->call = current_tracker->call;
+	} else {
+		tracker->call = tracker;
+		tracker->threads = ctx->threads;
+		tracker->spare_threads = ctx->threads - 1;
+	}
+	current_tracker = tracker;
+}
+
+/*
+ * Makes the enclosing call the running one again; a thread leaving its outermost call hands its counters to stats
+ */
+static void trackerStop(struct tracker *tracker)
+{
+	current_tracker = tracker->outer;
+	if (current_tracker == NULL) {
+		statsMerge();
+	}
+}
+
+/*
+ * Ends a successful library call; its allocations now belong to the caller
+ */
+void trackerEnd(struct tracker *tracker)
+{
+	struct alloc_header *header = tracker->list.next;
+	while (header != &tracker->list) {
+		struct alloc_header *next = header->next;
+		header->prev = NULL;
+		header->next = NULL;
+		__atomic_sub_fetch(&tracker->ctx->live_bytes, sizeof(struct alloc_header) + header->bytes, __ATOMIC_RELAXED);
+		header = next;
+	}
+	trackerStop(tracker);
+}
+
+/*
+ * Stops tracking on the calling thread but keeps the list, so that another thread can adopt it with trackerAdopt
+ */
+void trackerLeave(struct tracker *tracker)
+{
+	trackerStop(tracker);
+}
+
+/*
+ * Moves all allocations of a finished child into the list of tracker
+ */
+void trackerAdopt(struct tracker *tracker, struct tracker *child)
+{
+	if (child->list.next == &child->list) {
+		return;
+	}
+	child->list.next->prev = tracker->list.prev;
+	tracker->list.prev->next = child->list.next;
+	child->list.prev->next = &tracker->list;
+	tracker->list.prev = child->list.prev;
+	child->list.prev = &child->list;
+	child->list.next = &child->list;
+}
+
+/*
+ * Frees every allocation of a failed library call
+ */
+void trackerAbort(struct tracker *tracker)
+{
+	while (tracker->list.next != &tracker->list) {
+		contextFree(tracker->list.next + 1);
+	}
+	trackerStop(tracker);
+}
+
+/*
+ * Reserves one of the threads the running library call may start besides those running already; returns false if there is none left
+ * or if there is no library call
+ */
+bool trackerTakeThread(void)
+{
+	if (current_tracker == NULL) {
+		return false;
+	}
+	size_t *spare = &current_tracker->call->spare_threads;
+	size_t count = __atomic_load_n(spare, __ATOMIC_RELAXED);
+	while (count > 0 && !__atomic_compare_exchange_n(spare, &count, count - 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+	return count > 0;
+}
+
+/*
+ * Gives back a thread reserved with trackerTakeThread once it has ended
+ */
+void trackerReturnThread(void)
+{
+	__atomic_add_fetch(&current_tracker->call->spare_threads, 1, __ATOMIC_RELAXED);
+}
+
+void *defaultAlloc(size_t bytes, void *opaque)
+{
+	(void)opaque;
+	return malloc(bytes);
+}
+
+void *defaultRealloc(void *ptr, size_t bytes, void *opaque)
+{
+	(void)opaque;
+	return realloc(ptr, bytes);
+}
+
+void defaultFree(void *ptr, void *opaque)
+{
+	(void)opaque;
+	free(ptr);
+}
+
+/*
+ * Creates a context using allocator for all blocks, or malloc if allocator is NULL
+ * Results handed out by the context have to be freed before the context is destroyed
+ */
+int sqrt2CtxCreate(struct sqrt2_ctx **ctx, const struct sqrt2_allocator *allocator)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+
+	struct sqrt2_allocator fallback = {defaultAlloc, defaultRealloc, defaultFree, NULL};
+	if (allocator == NULL) {
+		allocator = &fallback;
+	}
+	if (allocator->alloc == NULL || allocator->realloc == NULL || allocator->free == NULL) {
+		return SQRT2_EINVAL;
+	}
+
+	*ctx = allocator->alloc(sizeof(struct sqrt2_ctx), allocator->opaque);
+	if (*ctx == NULL) {
+		return SQRT2_ENOMEM;
+	}
+	(*ctx)->allocator = *allocator;
+	(*ctx)->tuning = default_tuning;
+	(*ctx)->engine = SQRT2_ENGINE_AUTO;
+	(*ctx)->threads = 1;
+	(*ctx)->processes = 1;
+	(*ctx)->max_bytes = 0;
+	(*ctx)->live_bytes = 0;
+	(*ctx)->verify = false;
+	(*ctx)->huge_pages = true;
+	(*ctx)->numa = SQRT2_NUMA_DEFAULT;
+	(*ctx)->best_prec = 0;
+	(*ctx)->cache_dir = NULL;
+	(*ctx)->cache_limit = 0;
+	(*ctx)->cache.used = false;
+	(*ctx)->worker = NULL;
+	progressInit(&(*ctx)->progress);
+	return SQRT2_OK;
+}
+
+/*
+ * Frees the context and the result it holds
+ */
+void sqrt2CtxDestroy(struct sqrt2_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	sqrt2CtxClear(ctx);
+	struct sqrt2_allocator allocator = ctx->allocator;
+	if (ctx->cache_dir != NULL) {
+		allocator.free(ctx->cache_dir, allocator.opaque);
+	}
+	if (ctx->worker != NULL) {
+		allocator.free(ctx->worker, allocator.opaque);
+	}
+	allocator.free(ctx, allocator.opaque);
+}
+
+/*
+ * Drops the result held by the context, the next request gets computed again
+ */
+void sqrt2CtxClear(struct sqrt2_ctx *ctx)
+{
+	if (ctx != NULL && ctx->best_prec != 0) {
+		bignumFree(&ctx->best);
+		ctx->best_prec = 0;
+	}
+}
+
+/*
+ * Sets the number of threads the splitting may use
+ */
+int sqrt2CtxSetThreads(struct sqrt2_ctx *ctx, size_t threads)
+{
+	if (ctx == NULL || threads == 0) {
+		return SQRT2_EINVAL;
+	}
+	ctx->threads = threads;
+	return SQRT2_OK;
+}
+
+/*
+ * Sets the number of worker processes the splitting of the truncated engine and of extended runs gets distributed over
+ */
+int sqrt2CtxSetProcesses(struct sqrt2_ctx *ctx, size_t processes)
+{
+	if (ctx == NULL || processes == 0) {
+		return SQRT2_EINVAL;
+	}
+	ctx->processes = processes;
+	return SQRT2_OK;
+}
+
+/*
+ * Limits the memory the calls on the context may hold at once to max_bytes, 0 removes the limit; the calls plan within it, use
+ * fewer threads and the truncated splitting if needed, and fail with SQRT2_ENOMEM before computing if it is still too small
+ */
+int sqrt2CtxSetMemory(struct sqrt2_ctx *ctx, size_t max_bytes)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+	ctx->max_bytes = max_bytes;
+	return SQRT2_OK;
+}
+
+int sqrt2CtxSetEngine(struct sqrt2_ctx *ctx, enum sqrt2_engine engine)
+{
+	if (ctx == NULL || engine > SQRT2_ENGINE_AUTO) {
+		return SQRT2_EINVAL;
+	}
+	ctx->engine = engine;
+	return SQRT2_OK;
+}
+
+/*
+ * Enables checking every merge of the splitting by residues and every computed result by squaring it, failures return SQRT2_EVERIFY
+ */
+int sqrt2CtxSetVerify(struct sqrt2_ctx *ctx, int enabled)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+	ctx->verify = enabled != 0;
+	return SQRT2_OK;
+}
+
+/*
+ * Sets whether blocks of at least 1 MiB get mapped directly with transparent huge pages and where on a NUMA machine the pages of
+ * those mappings go; only takes effect with the default allocator
+ */
+int sqrt2CtxSetPages(struct sqrt2_ctx *ctx, int huge_pages, enum sqrt2_numa numa)
+{
+	if (ctx == NULL || numa > SQRT2_NUMA_LOCAL) {
+		return SQRT2_EINVAL;
+	}
+	ctx->huge_pages = huge_pages != 0;
+	ctx->numa = numa;
+	return SQRT2_OK;
+}
+
+int sqrt2CtxSetTuning(struct sqrt2_ctx *ctx, const struct sqrt2_tuning *tuning)
+{
+	if (ctx == NULL || tuning == NULL || tuning->parallel_grain == 0) {
+		return SQRT2_EINVAL;
+	}
+	ctx->tuning = *tuning;
+	return SQRT2_OK;
+}
+
+/*
+ * Replaces the string *target with a copy of text made with the allocator of the context, or with NULL if text is NULL
+ */
+static int contextSetText(struct sqrt2_ctx *ctx, char **target, const char *text)
+{
+	char *copied = NULL;
+	if (text != NULL) {
+		copied = ctx->allocator.alloc(strlen(text) + 1, ctx->allocator.opaque);
+		if (copied == NULL) {
+			return SQRT2_ENOMEM;
+		}
+		strcpy(copied, text);
+	}
+	if (*target != NULL) {
+		ctx->allocator.free(*target, ctx->allocator.opaque);
+	}
+	*target = copied;
+	return SQRT2_OK;
+}
+
+/*
+ * Sets the directory of the digit cache: requests the result held by the context does not cover are served from it if it holds
+ * enough bits, computed results get stored there, keeping the entries within limit bytes together by removing the oldest ones first
+ * (no limit if limit is 0)
+ * A dir of NULL stops using the cache
+ */
+int sqrt2CtxSetCache(struct sqrt2_ctx *ctx, const char *dir, size_t limit)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+	int status = contextSetText(ctx, &ctx->cache_dir, dir);
+	if (status == SQRT2_OK) {
+		ctx->cache_limit = limit;
+	}
+	return status;
+}
+
+/*
+ * Sets the program the worker processes of the splitting run as: it gets executed with --split-worker and the settings of the
+ * context, reads jobs from stdin and writes the replies to stdout (see distribute.h)
+ * A path of NULL runs the running program itself, which has to accept these options then
+ */
+int sqrt2CtxSetWorker(struct sqrt2_ctx *ctx, const char *path)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+	return contextSetText(ctx, &ctx->worker, path);
+}
+
+/*
+ * Returns what the last request on the context found in its digit cache
+ */
+const struct cache_report *sqrt2CacheReport(const struct sqrt2_ctx *ctx)
+{
+	return &ctx->cache;
+}
+
+/*
+ * Returns the progress of the library calls on the context, for reporting it from another thread while they run
+ */
+struct progress *sqrt2CtxProgress(struct sqrt2_ctx *ctx)
+{
+	return &ctx->progress;
+}
+
+/*
+ * Plans computing digits places in base 16 or 10 with the settings of the context into plan: the engine, picked by the precision if
+ * the context leaves it to SQRT2_ENGINE_AUTO, and within the memory budget fewer threads or the truncated splitting if needed
+ * Returns SQRT2_ENOMEM if even those exceed the budget, plan holds the cheapest settings then, and SQRT2_EINVAL if the places need
+ * a precision or a number of terms beyond SQRT2_MAX_TERMS, or more than the series can sum if it is the engine
+ */
+int sqrt2Plan(struct sqrt2_ctx *ctx, unsigned base, size_t digits, struct plan *plan)
+{
+	if (ctx == NULL || plan == NULL || (base != 16 && base != 10)) {
+		return SQRT2_EINVAL;
+	}
+	if (!planCompute(plan, digits, base) || plan->terms > SQRT2_MAX_TERMS) {
+		return SQRT2_EINVAL;
+	}
+
+	enum sqrt2_engine engine = ctx->engine;
+	if (engine == SQRT2_ENGINE_AUTO) {
+		engine = engineChoose(plan, plan->reason, sizeof(plan->reason));
+	} else {
+		snprintf(plan->reason, sizeof(plan->reason), "set in the context");
+	}
+	enum sqrt2_engine chosen = engine;
+	size_t threads = ctx->threads;
+	bool fits = ctx->max_bytes == 0 || planFit(plan, ctx->max_bytes, &engine, &threads);
+	if (engine != chosen) {
+		size_t length = strlen(plan->reason);
+		snprintf(plan->reason + length, sizeof(plan->reason) - length, ", %s needs less memory", engineGet(engine)->description);
+	}
+	plan->engine = engine;
+	plan->threads = threads;
+	plan->memory = planMemory(plan, engine, threads);
+	plan->fitted = engine != chosen || threads != ctx->threads;
+	// The series divides by 4n in a single block, sqrt2_V1 sums the terms 1 to terms - 1
+	if (engine == SQRT2_ENGINE_SERIES && plan->terms - 1 >= SQRT2_SERIES_MAX_TERMS) {
+		return SQRT2_EINVAL;
+	}
+	return fits ? SQRT2_OK : SQRT2_ENOMEM;
+}
+
+/*
+ * Checks the result by squaring it if the context asks for it, in the running library call
+ */
+static void contextVerify(const struct bignum *result, size_t bits)
+{
+	if (!current_tracker->ctx->verify) {
+		return;
+	}
+	uint64_t start = statsBegin(PHASE_VERIFY);
+	bool verified = sqrt2Verify(result, bits);
+	statsPhase(PHASE_VERIFY, start);
+	if (!verified) {
+		contextFail(SQRT2_EVERIFY, "Error: result failed verification!\n");
+	}
+}
+
+/*
+ * Makes the context hold a copy of the result with prec bits, so that requests for fewer places get truncated from it
+ */
+static void contextHold(struct sqrt2_ctx *ctx, const struct bignum *result, size_t prec)
+{
+	struct bignum held;
+	copy((struct bignum *)result, &held, 0, result->length - 1);
+	held.subone = result->subone;
+	sqrt2CtxClear(ctx);
+	ctx->best = held;
+	ctx->best_prec = prec;
+}
+
+/*
+ * Computes sqrt2 precise enough to print digits places in base 16 or 10 into result, which the caller frees with bignumFree
+ * Requests the context's result covers get truncated from it, the others get served from the digit cache of the context if it holds
+ * enough bits and computed with the engine sqrt2Plan picks otherwise
+ */
+int sqrt2Value(struct sqrt2_ctx *ctx, unsigned base, size_t digits, struct bignum *result)
+{
+	if (ctx == NULL || result == NULL) {
+		return SQRT2_EINVAL;
+	}
+
+	// Within a memory budget the run may need fewer threads or the truncated splitting, a budget too small fails before computing
+	struct plan plan;
+	int planned = sqrt2Plan(ctx, base, digits, &plan);
+	if (planned == SQRT2_EINVAL) {
+		return planned;
+	}
+	bool held = ctx->best_prec >= plan.prec;
+	ctx->cache.used = !held && ctx->cache_dir != NULL;
+
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		return tracker.status;
+	}
+	// The call runs with the threads of the plan, the context keeps the configured ones for the next call
+	tracker.threads = plan.threads;
+	tracker.spare_threads = plan.threads - 1;
+
+	if (held) {
+		copy(&ctx->best, result, 0, ctx->best.length - 1);
+		result->subone = ctx->best.subone;
+		cutToBits(result, plan.prec);
+		trackerEnd(&tracker);
+		return SQRT2_OK;
+	}
+
+	if (ctx->cache.used) {
+		ctx->cache.hit = cacheLookup(ctx->cache_dir, plan.prec, result, &ctx->cache.entry_prec);
+		ctx->cache.stored = false;
+		cacheRecord(ctx->cache_dir, ctx->cache.hit, &ctx->cache.stats);
+	}
+	if (ctx->cache.used && ctx->cache.hit) {
+		statsEngine("cache", "the digit cache holds enough bits");
+	} else if (planned != SQRT2_OK) {
+		trackerAbort(&tracker);
+		return planned;
+	} else {
+		const struct engine *run = engineGet(plan.engine);
+		statsEngine(run->name, plan.reason);
+		*result = run->compute(&plan);
+	}
+	contextVerify(result, plan.bits);
+	if (ctx->cache.used && !ctx->cache.hit) {
+		ctx->cache.stored = cacheStore(ctx->cache_dir, result, plan.prec, ctx->cache_limit);
+	}
+	contextHold(ctx, result, plan.prec);
+
+	trackerEnd(&tracker);
+	return SQRT2_OK;
+}
+
+/*
+ * Computes sqrt2 precise enough to print digits places in base 16 or 10 into result with the exact splitting, continuing the run
+ * saved in the file at load_path if it is not NULL, and saves the state of the run to the file at save_path if it is not NULL
+ * loaded_terms receives the n of the terms [1, n) the loaded state covered, 0 without one; fails with SQRT2_EIO if a file
+ * cannot be read or written, and with SQRT2_ENOMEM before computing anything if the memory budget of the context cannot hold the
+ * run and its state (see planSavedMemory)
+ */
+int sqrt2Extend(struct sqrt2_ctx *ctx, unsigned base, size_t digits, const char *load_path, const char *save_path, size_t *loaded_terms,
+	struct bignum *result)
+{
+	if (ctx == NULL || result == NULL || loaded_terms == NULL || (base != 16 && base != 10)) {
+		return SQRT2_EINVAL;
+	}
+	*loaded_terms = 0;
+	struct plan plan;
+	if (!planCompute(&plan, digits, base) || plan.terms > SQRT2_MAX_TERMS) {
+		return SQRT2_EINVAL;
+	}
+	if (ctx->max_bytes != 0 && planSavedMemory(&plan) > ctx->max_bytes) {
+		return SQRT2_ENOMEM;
+	}
+
+	struct sqrt2_state state;
+	stateInit(&state);
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		// The blocks of the state get freed with the failed call
+		trackerAbort(&tracker);
+		return tracker.status;
+	}
+
+	if (load_path != NULL && !stateLoad(&state, load_path)) {
+		contextFail(SQRT2_EIO, "Error: could not read the saved state!\n");
+	}
+	*loaded_terms = state.n;
+	statsEngine(engineGet(SQRT2_ENGINE_SPLIT)->name, "needed to save or extend the state of a run");
+	*result = sqrt2_extend(&state, plan.terms, plan.prec);
+	contextVerify(result, plan.bits);
+	if (save_path != NULL && !stateSave(&state, save_path)) {
+		contextFail(SQRT2_EIO, "Error: could not write the state!\n");
+	}
+	stateFree(&state);
+	contextHold(ctx, result, plan.prec);
+
+	trackerEnd(&tracker);
+	return SQRT2_OK;
+}
+
+/*
+ * Checks that x approximates sqrt2 to bits binary places by squaring it; returns SQRT2_EVERIFY if it does not
+ */
+int sqrt2Check(struct sqrt2_ctx *ctx, const struct bignum *x, size_t bits)
+{
+	if (ctx == NULL || x == NULL) {
+		return SQRT2_EINVAL;
+	}
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		return tracker.status;
+	}
+	uint64_t start = statsBegin(PHASE_VERIFY);
+	bool verified = sqrt2Verify(x, bits);
+	statsPhase(PHASE_VERIFY, start);
+	trackerEnd(&tracker);
+	return verified ? SQRT2_OK : SQRT2_EVERIFY;
+}
+
+/*
+ * Multiplies x and y into product, which the caller frees with bignumFree, with the thresholds of the context
+ */
+int sqrt2Multiply(struct sqrt2_ctx *ctx, struct bignum *x, struct bignum *y, struct bignum *product)
+{
+	if (ctx == NULL || x == NULL || y == NULL || product == NULL) {
+		return SQRT2_EINVAL;
+	}
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		return tracker.status;
+	}
+	*product = karazMult(x, y);
+	trackerEnd(&tracker);
+	return SQRT2_OK;
+}
+
+/*
+ * Formats the places of sqrt2 as text: all digits places after the comma, or only the count places following the first from
+ * places if window is set
+ */
+static int formatDigits(struct sqrt2_ctx *ctx, unsigned base, bool window, size_t from, size_t count, char **text, size_t *length)
+{
+	if (text == NULL) {
+		return SQRT2_EINVAL;
+	}
+
+	size_t digits = window ? from + count : count;
+	struct bignum result;
+	int status = sqrt2Value(ctx, base, digits, &result);
+	if (status != SQRT2_OK) {
+		return status;
+	}
+
+	char *buffer = NULL;
+	size_t buffer_length = 0;
+	FILE *stream = open_memstream(&buffer, &buffer_length);
+	if (stream == NULL) {
+		bignumFree(&result);
+		return SQRT2_ENOMEM;
+	}
+
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		fclose(stream);
+		free(buffer);
+		bignumFree(&result);
+		return tracker.status;
+	}
+	if (window && base == 16) {
+		printHexWindow(stream, &result, from, count);
+	} else if (window) {
+		bignumPrintDecWindow(stream, &result, from, count);
+	} else if (base == 16) {
+		printResultHex(stream, &result, digits);
+	} else {
+		bignumPrintDec(stream, &result, digits);
+	}
+	trackerEnd(&tracker);
+	bignumFree(&result);
+
+	if (fclose(stream) != 0) {
+		free(buffer);
+		return SQRT2_ENOMEM;
+	}
+	// Drops the line break of the print functions
+	if (buffer_length > 0 && buffer[buffer_length - 1] == '\n') {
+		buffer[--buffer_length] = '\0';
+	}
+	*text = buffer;
+	if (length != NULL) {
+		*length = buffer_length;
+	}
+	return SQRT2_OK;
+}
+
+/*
+ * Computes digits places of sqrt2 in base 16 or 10 as text of the form 1,6a09e...; text gets freed with sqrt2FreeText
+ */
+int sqrt2Digits(struct sqrt2_ctx *ctx, unsigned base, size_t digits, char **text, size_t *length)
+{
+	return formatDigits(ctx, base, false, 0, digits, text, length);
+}
+
+/*
+ * Computes only the places from + 1 to from + count after the comma as text without integer part and comma, e.g. 9e667 for
+ * from = 3 and count = 5 in base 16; skipping the first places keeps the conversion proportional to count
+ */
+int sqrt2DigitsWindow(struct sqrt2_ctx *ctx, unsigned base, size_t from, size_t count, char **text, size_t *length)
+{
+	if (count == 0 || from + count < from) {
+		return SQRT2_EINVAL;
+	}
+	return formatDigits(ctx, base, true, from, count, text, length);
+}
+
+/*
+ * Serves a coordinator as worker: answers the jobs read from the file descriptor in with the results written to out until in ends,
+ * e.g. with stdin and stdout of a remote shell; both descriptors get closed
+ */
+int sqrt2Worker(struct sqrt2_ctx *ctx, int in, int out)
+{
+	if (ctx == NULL) {
+		return SQRT2_EINVAL;
+	}
+	FILE *job = fdopen(in, "rb");
+	FILE *reply = fdopen(out, "wb");
+	if (job == NULL || reply == NULL) {
+		if (job != NULL) {
+			fclose(job);
+		}
+		if (reply != NULL) {
+			fclose(reply);
+		}
+		return SQRT2_EINVAL;
+	}
+
+	// A worker computes its jobs itself instead of distributing them again
+	size_t processes = ctx->processes;
+	ctx->processes = 1;
+
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	int status = SQRT2_OK;
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		status = tracker.status;
+	} else {
+		if (!distributeServe(job, reply)) {
+			status = SQRT2_EINTERNAL;
+		}
+		trackerEnd(&tracker);
+	}
+
+	ctx->processes = processes;
+	bool closed = fclose(job) == 0;
+	closed = fclose(reply) == 0 && closed;
+	return status == SQRT2_OK && !closed ? SQRT2_EINTERNAL : status;
+}
+
+void sqrt2FreeText(struct sqrt2_ctx *ctx, char *text)
+{
+	(void)ctx;
+	free(text);
+}
+
+const char *sqrt2Strerror(int status)
+{
+	switch (status) {
+		case SQRT2_OK:
+			return "success";
+		case SQRT2_ENOMEM:
+			return "out of memory";
+		case SQRT2_EINVAL:
+			return "invalid argument";
+		case SQRT2_EPRECISION:
+			return "precision could not be guaranteed";
+		case SQRT2_EVERIFY:
+			return "verification failed";
+		case SQRT2_EIO:
+			return "reading or writing a file failed";
+		default:
+			return "internal error";
+	}
+}
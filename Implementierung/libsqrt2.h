@@ -0,0 +1,99 @@
+#ifndef LIBSQRT2_H
+#define LIBSQRT2_H
+
+#include <stddef.h>
+
+/*
+ * Public interface of libsqrt2
+ * Every function returns one of the status codes, a context may be used by one thread at a time,
+ * several threads can compute at once with separate contexts
+ */
+
+enum sqrt2_status {
+	SQRT2_OK = 0,
+	SQRT2_ENOMEM,
+	SQRT2_EINVAL,
+	SQRT2_EPRECISION,
+	SQRT2_EVERIFY,
+	SQRT2_EIO,
+	SQRT2_EINTERNAL
+};
+
+/*
+ * Engines computing the places; SQRT2_ENGINE_AUTO picks one of the others per request by its precision, from the crossovers
+ * measured by make tune
+ */
+enum sqrt2_engine {
+	SQRT2_ENGINE_SPLIT,
+	SQRT2_ENGINE_TRUNCATED,
+	SQRT2_ENGINE_SERIES,
+	SQRT2_ENGINE_AUTO
+};
+
+/*
+ * Placement of the pages of large blocks on NUMA machines: the default policy of the process, spread over all nodes, or bound to
+ * the node of the thread allocating them
+ */
+enum sqrt2_numa {
+	SQRT2_NUMA_DEFAULT,
+	SQRT2_NUMA_INTERLEAVE,
+	SQRT2_NUMA_LOCAL
+};
+
+/*
+ * Allocator used for all blocks of a context; opaque gets passed through to every call
+ */
+struct sqrt2_allocator {
+	void *(*alloc)(size_t bytes, void *opaque);
+	void *(*realloc)(void *ptr, size_t bytes, void *opaque);
+	void (*free)(void *ptr, void *opaque);
+	void *opaque;
+};
+
+/*
+ * Thresholds of the arithmetic; mult_basecase is the operand length in blocks up to which karazMult multiplies directly, 0 takes
+ * the crossover of the multiplication kernel selected for the processor,
+ * parallel_grain the smallest number of terms a subtree of the splitting needs to be handed to another thread
+ */
+struct sqrt2_tuning {
+	size_t mult_basecase;
+	size_t parallel_grain;
+};
+
+struct sqrt2_ctx;
+
+int sqrt2CtxCreate(struct sqrt2_ctx **ctx, const struct sqrt2_allocator *allocator);
+
+void sqrt2CtxDestroy(struct sqrt2_ctx *ctx);
+
+void sqrt2CtxClear(struct sqrt2_ctx *ctx);
+
+int sqrt2CtxSetThreads(struct sqrt2_ctx *ctx, size_t threads);
+
+int sqrt2CtxSetProcesses(struct sqrt2_ctx *ctx, size_t processes);
+
+int sqrt2CtxSetMemory(struct sqrt2_ctx *ctx, size_t max_bytes);
+
+int sqrt2CtxSetEngine(struct sqrt2_ctx *ctx, enum sqrt2_engine engine);
+
+int sqrt2CtxSetVerify(struct sqrt2_ctx *ctx, int enabled);
+
+int sqrt2CtxSetPages(struct sqrt2_ctx *ctx, int huge_pages, enum sqrt2_numa numa);
+
+int sqrt2CtxSetTuning(struct sqrt2_ctx *ctx, const struct sqrt2_tuning *tuning);
+
+int sqrt2CtxSetCache(struct sqrt2_ctx *ctx, const char *dir, size_t limit);
+
+int sqrt2CtxSetWorker(struct sqrt2_ctx *ctx, const char *path);
+
+int sqrt2Digits(struct sqrt2_ctx *ctx, unsigned base, size_t digits, char **text, size_t *length);
+
+int sqrt2DigitsWindow(struct sqrt2_ctx *ctx, unsigned base, size_t from, size_t count, char **text, size_t *length);
+
+int sqrt2Worker(struct sqrt2_ctx *ctx, int in, int out);
+
+void sqrt2FreeText(struct sqrt2_ctx *ctx, char *text);
+
+const char *sqrt2Strerror(int status);
+
+#endif
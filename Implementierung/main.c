@@ -2,11 +2,26 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <inttypes.h>
 #include <getopt.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "libsqrt2.h"
+#include "context.h"
 #include "sqrt2.h"
 #include "operations.h"
+#include "plan.h"
+#include "engines.h"
+#include "estimate.h"
+#include "cache.h"
+#include "server.h"
+#include "stats.h"
+#include "perf.h"
+#include "progress.h"
+#include "kernels.h"
 
 const char* usage_msg =
 	"Usage: %s [options]	Approximates the square root of 2\n"
@@ -15,16 +30,44 @@ const char* usage_msg =
 
 const char* help_msg = 
 	"Optional arguments:\n"
-	"  -V<int>	Defines version of the programm to be run (default: 0)\n"
+	"  -V<engine>	Defines the engine to be run: auto, series, truncated or split, 0 for split and 1 for series (default: auto, picks by the precision from the crossover measured by make tune)\n"
 	"  -B<int>	Gives runtime of the function, additional value <int> defines the number of reruns (default: 10)\n"
 	"  -d<int>	Gives <int> numbers of decimal places after comma (default: 5)\n"
 	"  -h<int>	Gives <int> number of hexadecimal places after comma (default: 5)\n"
-	"  -T<int>	Tests speed of multiplication for number of <int> blocks, number is initialized consecuantly with 0x00000001 and Multiplied with itself, reruns can be set with -B (default size: 5)\n"
+	"  --from <int>	Prints only the places after the first <int> places after the comma, together with --count\n"
+	"  --count <int>	Number of places printed from --from on (default: the places of -d or -h)\n"
+	"  --truncate	Truncates P, Q and T at the upper levels of the binary splitting to the required precision, turns -V auto and -V split into -V truncated\n"
+	"  --plan	Shows the precision, guard blocks and series terms planned for the requested places and exit\n"
+	"  --estimate[=compare]	Predicts time per phase, peak memory and multiplication work of the run from the costs of make tune or fixed defaults and exit; compare runs it and prints prediction and actual figures to stderr\n"
+	"  --save <file>	Saves P, Q, T and the reciprocal of the run to <file> so that a later run can extend it, needs the exact splitting (-V auto or -V split)\n"
+	"  --extend <file>	Extends the run saved in <file> by computing only the additional terms, needs the exact splitting (-V auto or -V split)\n"
+	"  --cache <dir>	Serves the places from the digit cache in <dir> if it holds enough, otherwise computes and stores them there\n"
+	"  --cache-limit <MiB>	Keeps the entries of the cache within <MiB> together, removing the oldest ones first (default: no limit)\n"
+	"  --serve	Keeps running and answers requests \"hex <places>\" or \"dec <places>\" read line by line from stdin\n"
+	"  --socket <path>	Reads the requests of --serve from connections to a Unix socket at <path> instead\n"
+	"  --workers <int>	Number of threads computing requests of --serve (default: number of processors)\n"
+	"  --progress[=<seconds>]	Reports the phase, how far it got and the time it still needs to stderr every <seconds> (default: 1)\n"
+	"  --progress-file <path>	Writes the progress reports to <path> instead, replacing the previous one; with either of them SIGUSR1 prints the progress and all counters of --stats to stderr\n"
+	"  --stats[=json]	Prints time per phase, operation counts by size and memory use to stderr as table or JSON\n"
+	"  --threads <int>	Number of threads the binary splitting of --truncate may use (default: 1)\n"
+	"  --processes <int>	Number of worker processes the binary splitting of --truncate is distributed over, each with --threads threads (default: 1)\n"
+	"  --split-worker	Computes parts of the binary splitting for a coordinator, reading jobs from stdin and writing the results to stdout\n"
+	"  --verify	Checks the result by squaring it and the merges of the binary splitting by residues, reports the time taken\n"
+	"  --max-mem <MiB>	Plans the run to hold at most <MiB> of blocks, with fewer threads or --truncate if needed, fails right away if that is impossible\n"
+	"  --numa <policy>	Places the pages of large blocks interleaved over all NUMA nodes (interleave) or on the node of the thread allocating them (local)\n"
+	"  --no-huge-pages	Allocates large blocks with malloc instead of mapping them with transparent huge pages\n"
+	"  --kernel <name>	Multiplies short operands with the kernel <name> (scalar, avx2 or ifma) instead of the fastest one the processor supports\n"
+	"  --perf	Reads hardware counters (cycles, instructions, cache and branch misses) around the measured parts of -B and -T\n"
+	"  -T<int>	Tests speed of multiplication for number of <int> blocks, number is initialized consecuantly with 0x00000001 and Multiplied with itself, reruns can be set with -B (default size: 5), reports the kernel used\n"
 	"  --help	 Shows help message (this text) and exit\n"
-	"  -h		 Shows help message (this text) and exit\n"
+	"  -h		 Shows help message (this text) and exit\n";
+
+const char* examples_msg =
 	"Examples:\n"
        	"  ./sqrt2 -B 		Shows 5 hexadecimal places and runtime for 10 reruns\n"
 	"  ./sqrt2 -h15	 	Shows 15 hexadecimal places\n"
+	"  ./sqrt2 -h1000 --save a.pqt\n"
+	"  ./sqrt2 -h2000 --extend a.pqt	Shows 2000 hexadecimal places, reusing the terms computed for 1000\n"
 	"  ./sqrt2 -T100 -B15	Tests speed of multiplication for number of 100 blocks with 15 reruns\n";
 
 void print_usage(const char* progname) 
@@ -35,17 +78,62 @@ void print_usage(const char* progname)
 void print_help(const char* progname) 
 {
 	print_usage(progname);
-	fprintf(stderr, "\n%s", help_msg);
+	fprintf(stderr, "\n%s%s", help_msg, examples_msg);
+}
+
+/*
+ * Computes the places with the engine set in ctx, terminates the program with the error of the library if it fails
+ */
+struct bignum compute(struct sqrt2_ctx *ctx, unsigned base, size_t digits)
+{
+	struct bignum result;
+	int status = sqrt2Value(ctx, base, digits, &result);
+	if (status != SQRT2_OK) {
+		fprintf(stderr, "Error: %s\n", sqrt2Strerror(status));
+		exit(EXIT_FAILURE);
+	}
+	return result;
 }
 
-struct bignum mainImplementation(size_t n, size_t s)
+/*
+ * Opens the hardware counters for --perf, reports if they are unavailable so that only wall times get measured
+ */
+bool openCounters(struct perf_counters *counters)
 {
-	return sqrt2(n, s);
+	if (perfOpen(counters)) {
+		return true;
+	}
+	perfClose(counters);
+	printf("Hardware counters unavailable (perf_event_open failed), measuring wall time only\n");
+	return false;
 }
 
-struct bignum secondImplementation(size_t n, size_t s)
+/*
+ * Reads a number of places from text; returns false unless text is a non-negative decimal integer that fits into places
+ */
+bool parsePlaces(const char *text, size_t *places)
 {
-	return sqrt2_V1(n, s);
+	char *end;
+	errno = 0;
+	unsigned long long value = strtoull(text, &end, 10);
+	if (*text < '0' || *text > '9' || *end != '\0' || errno == ERANGE || value > SIZE_MAX) {
+		return false;
+	}
+	*places = value;
+	return true;
+}
+
+/*
+ * Reads a size in MiB from text into bytes; returns false unless text is a positive decimal integer whose bytes fit into a size_t
+ */
+bool parseMebibytes(const char *text, size_t *bytes)
+{
+	size_t mebibytes;
+	if (!parsePlaces(text, &mebibytes) || mebibytes == 0 || mebibytes > SIZE_MAX / (1024 * 1024)) {
+		return false;
+	}
+	*bytes = mebibytes * 1024 * 1024;
+	return true;
 }
 
 int main(int argc, char** argv)
@@ -56,9 +144,34 @@ int main(int argc, char** argv)
 	size_t number_of_blocks = 5;
 	size_t number_of_decimal_places = 5;
 	size_t runtime_reruns = 10;
-	uint8_t version = 0;
-
-	size_t s;
+	enum sqrt2_engine engine = SQRT2_ENGINE_AUTO;
+	bool truncated = false;
+	bool show_plan = false;
+	bool show_estimate = false;
+	bool compare_estimate = false;
+	const char* save_path = NULL;
+	const char* extend_path = NULL;
+	const char* cache_dir = NULL;
+	size_t cache_limit = 0;
+	bool serve = false;
+	bool show_stats = false;
+	bool use_perf = false;
+	bool verify = false;
+	bool stats_json = false;
+	const char* socket_path = NULL;
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t workers = online > 0 ? online : 1;
+	size_t threads = 1;
+	size_t processes = 1;
+	size_t max_mem = 0;
+	double progress_interval = 0;
+	const char* progress_path = NULL;
+	bool split_worker = false;
+	bool huge_pages = true;
+	enum sqrt2_numa numa = SQRT2_NUMA_DEFAULT;
+	bool window = false;
+	size_t window_from = 0;
+	size_t window_count = 0;
 
 	const char* progname = argv[0];
 
@@ -68,7 +181,32 @@ int main(int argc, char** argv)
 	}
 
 	static struct option long_options[] = {
-		{"help",	  no_argument,	   0,  'h' }
+		{"help",	  no_argument,	   0,  'h' },
+		{"truncate",  no_argument,	   0,  't' },
+		{"plan",      no_argument,	   0,  'p' },
+		{"estimate",  optional_argument,  0,  'E' },
+		{"save",      required_argument,  0,  's' },
+		{"extend",    required_argument,  0,  'e' },
+		{"cache",     required_argument,  0,  'c' },
+		{"cache-limit", required_argument, 0, 'l' },
+		{"serve",     no_argument,	   0,  'S' },
+		{"socket",    required_argument,  0,  'u' },
+		{"workers",   required_argument,  0,  'w' },
+		{"stats",     optional_argument,  0,  'x' },
+		{"perf",      no_argument,	   0,  'P' },
+		{"threads",   required_argument,  0,  'j' },
+		{"processes", required_argument,  0,  'N' },
+		{"max-mem",   required_argument,  0,  'M' },
+		{"progress",  optional_argument,  0,  'R' },
+		{"progress-file", required_argument, 0, 'F' },
+		{"split-worker", no_argument,	   0,  'W' },
+		{"verify",    no_argument,	   0,  'v' },
+		{"kernel",    required_argument,  0,  'k' },
+		{"numa",      required_argument,  0,  'n' },
+		{"no-huge-pages", no_argument,	   0,  'H' },
+		{"from",      required_argument,  0,  'f' },
+		{"count",     required_argument,  0,  'C' },
+		{0,		  0,		   0,  0 }
 	};
 
 	int opt;
@@ -84,19 +222,158 @@ int main(int argc, char** argv)
 					return EXIT_SUCCESS;
 				} else {
 					result_in_hex = true;
-					number_of_decimal_places = strtol(optarg, NULL, 10);
-					if (number_of_decimal_places > 1000000) {
-						printf("Desired amount of decimal places is too great!\nStay within 0 and 1000000 (both inclusive).\n");
+					if (!parsePlaces(optarg, &number_of_decimal_places) || number_of_decimal_places > PLAN_MAX_PLACES) {
+						printf("Desired amount of decimal places is invalid or too great!\nStay within 0 and 1000000 (both inclusive).\n");
 						return EXIT_FAILURE;
 					}
 					break;
 				}
 			case 'd':
 				result_in_hex = false;
-				number_of_decimal_places = optarg ? strtol(optarg, NULL, 10) : 5;
+				number_of_decimal_places = 5;
+				if (optarg != NULL && (!parsePlaces(optarg, &number_of_decimal_places) || number_of_decimal_places > PLAN_MAX_PLACES)) {
+					printf("Desired amount of decimal places is invalid or too great!\nStay within 0 and 1000000 (both inclusive).\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 't':
+				truncated = true;
+				break;
+			case 'p':
+				show_plan = true;
+				break;
+			case 'E':
+				compare_estimate = optarg != NULL && strcmp(optarg, "compare") == 0;
+				show_estimate = !compare_estimate;
+				if (optarg != NULL && !compare_estimate) {
+					printf("Unknown estimate mode %s!\nUse --estimate or --estimate=compare.\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 's':
+				save_path = optarg;
+				break;
+			case 'e':
+				extend_path = optarg;
+				break;
+			case 'c':
+				cache_dir = optarg;
+				break;
+			case 'l':
+				if (!parseMebibytes(optarg, &cache_limit)) {
+					printf("Desired cache limit invalid!\nAllow at least 1 MiB, leave out --cache-limit for no limit.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'S':
+				serve = true;
+				break;
+			case 'P':
+				use_perf = true;
+				break;
+			case 'x':
+				show_stats = true;
+				stats_json = optarg != NULL && strcmp(optarg, "json") == 0;
+				if (optarg != NULL && !stats_json && strcmp(optarg, "table") != 0) {
+					printf("Unknown stats format %s, use table or json!\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'u':
+				socket_path = optarg;
+				break;
+			case 'w':
+				workers = strtol(optarg, NULL, 10);
+				if (workers == 0 || workers > 1024) {
+					printf("Desired amount of workers invalid!\nStay within 1 and 1024 (both inclusive).\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'v':
+				verify = true;
+				break;
+			case 'n':
+				if (strcmp(optarg, "interleave") == 0) {
+					numa = SQRT2_NUMA_INTERLEAVE;
+				} else if (strcmp(optarg, "local") == 0) {
+					numa = SQRT2_NUMA_LOCAL;
+				} else {
+					printf("Unknown NUMA policy %s, use interleave or local!\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'H':
+				huge_pages = false;
+				break;
+			case 'f':
+				window = true;
+				if (!parsePlaces(optarg, &window_from)) {
+					printf("Desired first place %s invalid!\nSkip a number of places from 0 on.\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'C':
+				window = true;
+				if (!parsePlaces(optarg, &window_count) || window_count == 0) {
+					printf("Desired amount of places invalid!\nPrint at least one place.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'k':
+				if (!kernelSelect(optarg)) {
+					printf("Kernel %s is unknown or not supported by this processor!\nChoose one of %s.\n", optarg, kernelNames());
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'j':
+				threads = strtol(optarg, NULL, 10);
+				if (threads == 0 || threads > 1024) {
+					printf("Desired amount of threads invalid!\nStay within 1 and 1024 (both inclusive).\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'N':
+				processes = strtol(optarg, NULL, 10);
+				if (processes == 0 || processes > 1024) {
+					printf("Desired amount of processes invalid!\nStay within 1 and 1024 (both inclusive).\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'W':
+				split_worker = true;
+				break;
+			case 'R':
+				progress_interval = optarg != NULL ? strtod(optarg, NULL) : 1;
+				if (progress_interval <= 0) {
+					printf("Desired progress interval invalid!\nReport at least once per run, e.g. every 0.5 seconds.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'F':
+				progress_path = optarg;
+				if (progress_interval == 0) {
+					progress_interval = 1;
+				}
+				break;
+			case 'M':
+				if (!parseMebibytes(optarg, &max_mem)) {
+					printf("Desired memory budget invalid!\nAllow at least 1 MiB.\n");
+					return EXIT_FAILURE;
+				}
 				break;
 			case 'V':
-				version = strtol(optarg, NULL, 10);
+				if (strcmp(optarg, "auto") == 0) {
+					engine = SQRT2_ENGINE_AUTO;
+				} else if (strcmp(optarg, "0") == 0) {
+					engine = SQRT2_ENGINE_SPLIT;
+				} else if (strcmp(optarg, "1") == 0) {
+					engine = SQRT2_ENGINE_SERIES;
+				} else if (engineFind(optarg) != NULL) {
+					engine = engineFind(optarg)->id;
+				} else {
+					printf("Unsupported engine %s!\nUse auto, %s.\n", optarg, engineNames());
+					return EXIT_FAILURE;
+				}
 				break;
 			case 'B':
 				if (optarg == 0) {
@@ -131,35 +408,98 @@ int main(int argc, char** argv)
 		}
 	}
 
+	if (serve) {
+		return serverRun(socket_path, workers);
+	}
+
+	if (split_worker) {
+		struct sqrt2_ctx *ctx;
+		if (sqrt2CtxCreate(&ctx, NULL) != SQRT2_OK) {
+			fprintf(stderr, "Error while allocation memory!");
+			return EXIT_FAILURE;
+		}
+		sqrt2CtxSetThreads(ctx, threads);
+		sqrt2CtxSetPages(ctx, huge_pages, numa);
+		sqrt2CtxSetVerify(ctx, verify);
+		int status = sqrt2Worker(ctx, STDIN_FILENO, STDOUT_FILENO);
+		sqrt2CtxDestroy(ctx);
+		if (status != SQRT2_OK) {
+			fprintf(stderr, "Error: %s\n", sqrt2Strerror(status));
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// A window needs all places up to its end, those before it are skipped when printing
+	if (window) {
+		if (window_count == 0) {
+			window_count = number_of_decimal_places;
+		}
+		if (window_count == 0) {
+			printf("Desired amount of places invalid!\nPrint at least one place.\n");
+			return EXIT_FAILURE;
+		}
+		// Compared without adding, so that a huge --from cannot wrap around; decimal windows get the cap of -h as well
+		if (window_from > PLAN_MAX_PLACES || window_count > PLAN_MAX_PLACES - window_from) {
+			printf("Desired window of places is too great!\nThe last place printed has to stay within 1 and 1000000 (both inclusive).\n");
+			return EXIT_FAILURE;
+		}
+		number_of_decimal_places = window_from + window_count;
+	}
+
 	struct bignum result;
 
+	struct sqrt2_ctx *ctx;
+	if (sqrt2CtxCreate(&ctx, NULL) != SQRT2_OK) {
+		fprintf(stderr, "Error while allocation memory!");
+		return EXIT_FAILURE;
+	}
+	sqrt2CtxSetThreads(ctx, threads);
+	sqrt2CtxSetProcesses(ctx, processes);
+	sqrt2CtxSetPages(ctx, huge_pages, numa);
+	// Reruns of -B are measured without the checks, only the last result gets verified below
+	sqrt2CtxSetVerify(ctx, verify && !benchmarking);
+
 	// Testing multiplication if flag is set
 	if (test_mult) {
 		// Setting up number
 		struct bignum operand;
 		operand.length = number_of_blocks;
 		operand.subone = 0;
-		operand.numbers = calloc(number_of_blocks, sizeof(uint32_t));
-		if (operand.numbers == NULL) {
-			fprintf(stderr, "Error while allocation memory!");
-			return EXIT_FAILURE;
-		}
+		operand.numbers = limbsAlloc(number_of_blocks);
 		for (size_t i = 0; i < number_of_blocks; i++) {
 			operand.numbers[i] = 1;
 		}
 
 		printf("Displaying runtimes of multiplication %ld blocks and %ld reruns:\n", number_of_blocks, runtime_reruns);
 		printf("Operand number: ");
-		printResultHex(&operand, 0);
+		printResultHex(stdout, &operand, 0);
 		// Workaround to avoid free on uninitialized
 		bignumInit(&result, 1);
 		// temp is used to temporally store the result
 		struct bignum temp;
 
+		struct perf_counters counters;
+		bool counting = use_perf && openCounters(&counters);
+
+		// The counters only run during the multiplications, not while the previous products get freed
+		if (counting) {
+			perfReset(&counters);
+		}
 		struct timespec start;
 		clock_gettime(CLOCK_MONOTONIC, &start);
 		for (size_t i = 0; i < runtime_reruns; i++) {
-			temp = karazMult(&operand, &operand);
+			if (counting) {
+				perfStart(&counters);
+			}
+			int status = sqrt2Multiply(ctx, &operand, &operand, &temp);
+			if (counting) {
+				perfStop(&counters);
+			}
+			if (status != SQRT2_OK) {
+				fprintf(stderr, "Error: %s\n", sqrt2Strerror(status));
+				return EXIT_FAILURE;
+			}
 			bignumFree(&result);
 			result = temp;
 		}
@@ -169,110 +509,227 @@ int main(int argc, char** argv)
 		double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
 		double avg_time = time/runtime_reruns;
 
+		const struct kernel *kernel = kernelCurrent();
+		printf("Kernel: %s, multiplying directly up to %zu blocks\n", kernel->name, kernel->basecase);
 		printf("done after %f seconds, average time is %f seconds\n", time, avg_time);
+		if (counting) {
+			perfPrint(stdout, &counters, "multiplication", (double)number_of_blocks * runtime_reruns);
+			perfClose(&counters);
+		}
 		printf("Result: ");
-		printResultHex(&result, 0);
+		printResultHex(stdout, &result, 0);
 		bignumFree(&result);
 		bignumFree(&operand);
+		sqrt2CtxDestroy(ctx);
+		if (show_stats) {
+			fflush(stdout);
+			statsPrint(stderr, stats_json);
+		}
 		return EXIT_SUCCESS;
 	}
 
-	switch(version){
-		case 0:
-			if (result_in_hex) {
-				s = number_of_decimal_places * 4;
-				if (benchmarking) {
-					printf("Displaying runtime of computing %ld places with %ld reruns:\n", number_of_decimal_places, runtime_reruns);
-					// Workatound to avoid free on uninitialized
-					bignumInit(&result, 1);
-					// temp is used to temporally store the result
-					struct bignum temp;
-					struct timespec start;
-					clock_gettime(CLOCK_MONOTONIC, &start);
-					for (size_t i = 0; i < runtime_reruns; i++) {
-						temp = mainImplementation(s + 1, s);
-						// Workaround to avoid memory leaks
-						bignumFree(&result);
-						result = temp;
-					}
-					struct timespec end;
-					clock_gettime(CLOCK_MONOTONIC, &end);
-					double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
-					double avg_time = time/runtime_reruns;
-					printf("done after %f seconds, average time is %f seconds\n", time, avg_time);
-				} else {
-					printf("Printing %ld hexadecimal places after comma...\n", number_of_decimal_places);
-					result = mainImplementation(s + 1, s);
-				}
-				printf("Result: ");
-				printResultHex(&result, number_of_decimal_places);
-				bignumFree(&result);
-			} else {
-				s = number_of_decimal_places;
-				if (benchmarking) {
-					printf("Displaying runtime of computing %ld places with %ld reruns:\n", number_of_decimal_places, runtime_reruns);
-					// Workatound to avoid free on uninitialized
-					bignumInit(&result, 1);
-					// temp is used to temporally store the result
-					struct bignum temp;
-					struct timespec start;
-					clock_gettime(CLOCK_MONOTONIC, &start);
-					for (size_t i = 0; i < runtime_reruns; i++) {
-						temp = mainImplementation(s + 1, s);
-						// Workaround to avoid memory leaks
-						bignumFree(&result);
-						result = temp;
-					}
-					struct timespec end;
-					clock_gettime(CLOCK_MONOTONIC, &end);
-					double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
-					double avg_time = time/runtime_reruns;
-					printf("done after %f seconds, average time is %f seconds\n", time, avg_time);
-				} else {
-					printf("Printing %ld hexadecimal places after comma...\n", number_of_decimal_places);
-					result = mainImplementation(s + 1, s);
-				}
-				printf("Result: ");
-				bignumPrintDec(&result, number_of_decimal_places);
-				bignumFree(&result);
+	// --truncate turns the splitting into the truncated one, saved runs need the exact splitting, other runs leave auto to the library
+	bool saved_run = save_path != NULL || extend_path != NULL;
+	if (truncated && (engine == SQRT2_ENGINE_SPLIT || engine == SQRT2_ENGINE_AUTO)) {
+		engine = SQRT2_ENGINE_TRUNCATED;
+	} else if (saved_run && engine == SQRT2_ENGINE_AUTO) {
+		engine = SQRT2_ENGINE_SPLIT;
+	}
+	// Runs based on a saved state compute only once, reruns would just reuse the state
+	if (saved_run && (engine != SQRT2_ENGINE_SPLIT || benchmarking)) {
+		printf("--save and --extend need the exact splitting (-V auto or -V split) and cannot be used with --truncate or -B!\n");
+		return EXIT_FAILURE;
+	}
+	sqrt2CtxSetEngine(ctx, engine);
+	sqrt2CtxSetMemory(ctx, max_mem);
+	unsigned base = result_in_hex ? 16 : 10;
+
+	// The library plans the precision, the term count and the engine within the budget before anything is computed
+	struct plan plan;
+	bool fits = sqrt2Plan(ctx, base, number_of_decimal_places, &plan) == SQRT2_OK;
+	if (show_plan) {
+		planPrint(&plan);
+		sqrt2CtxDestroy(ctx);
+		return EXIT_SUCCESS;
+	}
+	// Saved runs need the exact splitting and keep its state, the budget has to hold both of them
+	size_t needed = saved_run ? planSavedMemory(&plan) : plan.memory;
+	if (saved_run ? max_mem != 0 && needed > max_mem : !fits) {
+		printf("Memory budget of %zu MiB is too small, computing %ld places needs about %.1f MiB!\n", max_mem >> 20,
+			number_of_decimal_places, needed / 1048576.0);
+		return EXIT_FAILURE;
+	}
+	if (plan.fitted) {
+		printf("Within the memory budget of %zu MiB: %s with %zu threads\n", max_mem >> 20, engineGet(plan.engine)->description,
+			plan.threads);
+	}
+
+	// The prediction is for the settings the run ends up with within the budget
+	struct estimate estimate;
+	if (show_estimate || compare_estimate) {
+		struct machine_costs costs;
+		estimateCosts(&costs);
+		estimateRun(&estimate, &plan, plan.engine, plan.threads, processes, &costs);
+		if (show_estimate) {
+			printf("Estimate for %ld %s places, %s with %zu threads and %zu processes:\n", number_of_decimal_places,
+				result_in_hex ? "hexadecimal" : "decimal", engineGet(plan.engine)->description, plan.threads, processes);
+			estimatePrint(stdout, &estimate, &costs);
+			sqrt2CtxDestroy(ctx);
+			return EXIT_SUCCESS;
+		}
+	}
+
+	// The cache is only consulted for single runs, benchmarks always compute and saved runs need the terms
+	if (cache_dir != NULL && !benchmarking && !saved_run && sqrt2CtxSetCache(ctx, cache_dir, cache_limit) != SQRT2_OK) {
+		fprintf(stderr, "Error while allocation memory!");
+		return EXIT_FAILURE;
+	}
+
+	// The reports and the dumps on SIGUSR1 only come with --progress or --progress-file, a stray SIGUSR1 must not end the run
+	bool reporting = progress_interval > 0 && progressStart(sqrt2CtxProgress(ctx), progress_interval, progress_path);
+	if (!reporting) {
+		signal(SIGUSR1, SIG_IGN);
+	}
+
+	// Hardware counters are only read around the measured parts of -B
+	struct perf_counters counters;
+	bool counting = false;
+
+	if (saved_run) {
+		printf("Printing %ld %s places after comma...\n", number_of_decimal_places, result_in_hex ? "hexadecimal" : "decimal");
+		size_t loaded_terms;
+		int status = sqrt2Extend(ctx, base, number_of_decimal_places, extend_path, save_path, &loaded_terms, &result);
+		if (status == SQRT2_EIO) {
+			fprintf(stderr, "Could not %s!\n", extend_path != NULL && loaded_terms == 0 ? "read the state to extend" : "write the state");
+			return EXIT_FAILURE;
+		} else if (status != SQRT2_OK) {
+			fprintf(stderr, "Error: %s\n", sqrt2Strerror(status));
+			return EXIT_FAILURE;
+		}
+		if (extend_path != NULL) {
+			printf("Extended the terms [1, %zu) to [1, %zu)\n", loaded_terms, plan.terms > loaded_terms ? plan.terms : loaded_terms);
+		}
+	} else if (benchmarking) {
+		printf("Displaying runtime of computing %ld places with %ld reruns:\n", number_of_decimal_places, runtime_reruns);
+		// Workatound to avoid free on uninitialized
+		bignumInit(&result, 1);
+		// temp is used to temporally store the result
+		struct bignum temp;
+		counting = use_perf && openCounters(&counters);
+
+		// The counters only run during the computations, not while the context and the previous results get freed
+		if (counting) {
+			perfReset(&counters);
+		}
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (size_t i = 0; i < runtime_reruns; i++) {
+			// Every rerun computes, instead of being served the result the context holds
+			sqrt2CtxClear(ctx);
+			if (counting) {
+				perfStart(&counters);
 			}
-			break;
-		case 1: 
-			if (result_in_hex) {
-				s = number_of_decimal_places * 4;
-				if (benchmarking) {
-					printf("Displaying runtime of computing %ld places with %ld reruns:\n", number_of_decimal_places, runtime_reruns);
-					// Workatound to avoid free on uninitialized
-					bignumInit(&result, 1);
-					// temp is used to temporally store the result
-					struct bignum temp;
-					struct timespec start;
-					clock_gettime(CLOCK_MONOTONIC, &start);
-					for (size_t i = 0; i < runtime_reruns; i++) {
-						temp = secondImplementation(s + 1, s);
-						// Workaround to avoid memory leaks
-						bignumFree(&result);
-						result = temp;
-					}
-					struct timespec end;
-					clock_gettime(CLOCK_MONOTONIC, &end);
-					double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
-					double avg_time = time/runtime_reruns;
-					printf("done after %f seconds, average time is %f seconds.\n", time, avg_time);
-				} else {
-					printf("Printing %ld hexadecimal places after comma...\n", number_of_decimal_places);
-					result = secondImplementation(s + 1, s);
-				}
-				printf("Result: ");
-				printResultHex(&result, number_of_decimal_places);
-				bignumFree(&result);
-			} else {
-				printf("Feature not yet implemented!\n");
+			temp = compute(ctx, base, number_of_decimal_places);
+			if (counting) {
+				perfStop(&counters);
 			}
-			break;
-		default:
-			printf("Unsupported version number!\n");
+			// Workaround to avoid memory leaks
+			bignumFree(&result);
+			result = temp;
+		}
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double time = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+		double avg_time = time/runtime_reruns;
+		const struct kernel *kernel = kernelCurrent();
+		printf("Kernel: %s, multiplying directly up to %zu blocks\n", kernel->name, kernel->basecase);
+		printf("done after %f seconds, average time is %f seconds\n", time, avg_time);
+		const char *placement = numa == SQRT2_NUMA_INTERLEAVE ? "interleaved" : numa == SQRT2_NUMA_LOCAL ? "local" : "default";
+		printf("Memory: %" PRIu64 " large blocks mapped with huge pages, up to %.1f MiB backed by huge pages, NUMA placement %s\n",
+			stats.mappings, stats.huge_peak_bytes / 1048576.0, placement);
+		if (counting) {
+			perfPrint(stdout, &counters, "computation", (double)(plan.prec / 32 + 1) * runtime_reruns);
+		}
+	} else {
+		printf("Printing %ld %s places after comma...\n", number_of_decimal_places, result_in_hex ? "hexadecimal" : "decimal");
+		result = compute(ctx, base, number_of_decimal_places);
+	}
+
+	const struct cache_report *cache = sqrt2CacheReport(ctx);
+	bool cache_hit = cache->used && cache->hit;
+	if (cache_hit) {
+		printf("Cache hit: %zu bits served from the %zu bit entry (%zu hits, %zu misses)\n", plan.prec, cache->entry_prec,
+			cache->stats.hits, cache->stats.misses);
+	} else if (cache->used) {
+		printf("Cache miss: computed %zu bits (%zu hits, %zu misses)\n", plan.prec, cache->stats.hits, cache->stats.misses);
+		if (!cache->stored) {
+			printf("Result was not stored in the cache (size limit or %s not writable)\n", cache_dir);
+		}
+	}
+
+	if (verify) {
+		// The reruns of -B ran without the checks, the library verified every other result already
+		if (benchmarking && sqrt2Check(ctx, &result, plan.bits) != SQRT2_OK) {
+			fprintf(stderr, "Error: %s\n", sqrt2Strerror(SQRT2_EVERIFY));
 			return EXIT_FAILURE;
+		}
+		printf("Verified: the result is within 2^-%zu of sqrt2, checked in %f seconds\n", plan.bits, stats.phase_ns[PHASE_VERIFY] * 1e-9);
+	}
+
+	uint64_t output_start = statsBegin(PHASE_OUTPUT);
+	// The conversion runs outside of the library calls, its progress still counts for the context
+	progressUse(sqrt2CtxProgress(ctx));
+	if (counting) {
+		perfReset(&counters);
+		perfStart(&counters);
+	}
+	if (window) {
+		printf("Places %zu to %zu after comma:\n", window_from + 1, window_from + window_count);
+	}
+	printf("Result: ");
+	if (window && result_in_hex) {
+		printHexWindow(stdout, &result, window_from, window_count);
+	} else if (window) {
+		bignumPrintDecWindow(stdout, &result, window_from, window_count);
+	} else if (result_in_hex) {
+		printResultHex(stdout, &result, number_of_decimal_places);
+	} else {
+		bignumPrintDec(stdout, &result, number_of_decimal_places);
+	}
+	if (counting) {
+		perfStop(&counters);
+		fflush(stdout);
+		perfPrint(stdout, &counters, "output", plan.prec / 32 + 1);
+		perfClose(&counters);
+	}
+	statsPhase(PHASE_OUTPUT, output_start);
+	progressUse(NULL);
+	bignumFree(&result);
+	// The reporting thread reads the progress of the context until it stops
+	if (reporting) {
+		progressStop();
+	}
+	sqrt2CtxDestroy(ctx);
+
+	if (max_mem != 0) {
+		fflush(stdout);
+		fprintf(stderr, "Memory: peak RSS %.1f MiB, peak live blocks %.1f MiB, budget %zu MiB\n", statsPeakRss() / 1048576.0,
+			stats.peak_bytes / 1048576.0, max_mem >> 20);
+	}
+
+	// Only a single run computing everything itself can be compared with the prediction
+	if (compare_estimate) {
+		fflush(stdout);
+		if (benchmarking || cache_hit || extend_path != NULL) {
+			fprintf(stderr, "Estimate not compared, the run did not compute the whole result once\n");
+		} else {
+			estimateCompare(stderr, &estimate);
+		}
+	}
+
+	if (show_stats) {
+		fflush(stdout);
+		statsPrint(stderr, stats_json);
 	}
 
 	return EXIT_SUCCESS;
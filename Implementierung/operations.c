@@ -4,18 +4,71 @@
 #include <math.h>
 #include <inttypes.h>
 #include "operations.h"
+#include "context.h"
+#include "stats.h"
+#include "kernels.h"
+#include "fixed.h"
+#include "progress.h"
+#include "pages.h"
+
+// Size of the block count stored in front of every limb allocation, keeps the blocks 16 byte aligned
+#define LIMBS_HEADER 16
+
+// Bytes converted at once when writing or reading blocks
+#define STREAM_CHUNK 4096
 
 /*
- * Initializes the given bignum with the value n; allocates an additional 32 bit block for further operations
+ * Allocates count zeroed 32 bit blocks for the numbers of a bignum; fails the running library call if there is not enough memory
+ * The block count is kept in front of the blocks so that limbsFree can account for the memory
  */
-void bignumInit(struct bignum *num, size_t n)
+uint32_t *limbsAlloc(size_t count)
 {
-    num->numbers = calloc(3, sizeof(uint32_t));
-    if (num->numbers == NULL)
+    size_t *base = contextAlloc(LIMBS_HEADER + count * sizeof(uint32_t));
+    base[0] = count;
+    statsAlloc(count * sizeof(uint32_t));
+    return (uint32_t *)((char *)base + LIMBS_HEADER);
+}
+
+/*
+ * Resizes blocks allocated with limbsAlloc to count blocks; new blocks are not initialized
+ */
+uint32_t *limbsRealloc(uint32_t *limbs, size_t count)
+{
+    if (limbs == NULL)
     {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
+        return limbsAlloc(count);
     }
+
+    size_t *base = (size_t *)((char *)limbs - LIMBS_HEADER);
+    size_t old_count = base[0];
+    base = contextRealloc(base, LIMBS_HEADER + count * sizeof(uint32_t));
+    base[0] = count;
+    statsFree(old_count * sizeof(uint32_t));
+    statsAlloc(count * sizeof(uint32_t));
+    return (uint32_t *)((char *)base + LIMBS_HEADER);
+}
+
+/*
+ * Frees blocks allocated with limbsAlloc
+ */
+void limbsFree(uint32_t *limbs)
+{
+    if (limbs == NULL)
+    {
+        return;
+    }
+
+    size_t *base = (size_t *)((char *)limbs - LIMBS_HEADER);
+    statsFree(base[0] * sizeof(uint32_t));
+    contextFree(base);
+}
+
+/*
+ * Initializes the given bignum with the value n; allocates an additional 32 bit block for further operations
+ */
+void bignumInit(struct bignum *num, size_t n)
+{
+    num->numbers = limbsAlloc(3);
     num->numbers[0] = n % 0x100000000;
     num->length = 1;
     if (n > UINT32_MAX)
@@ -31,7 +84,7 @@ void bignumInit(struct bignum *num, size_t n)
  */
 void bignumFree(struct bignum *num)
 {
-    free(num->numbers);
+    limbsFree(num->numbers);
 }
 
 /*
@@ -62,53 +115,320 @@ void bignumCopy(const struct bignum *x, uint32_t *num)
 }
 
 /*
- * print bignum in decimal values
+ * Computes base^e as an integer bignum by repeated squaring
+ */
+struct bignum bignumPow(uint32_t base, size_t e)
+{
+    struct bignum res;
+    struct bignum factor;
+    struct bignum temp;
+
+    bignumInit(&res, 1);
+    bignumInit(&factor, base);
+
+    while (e > 0)
+    {
+        if (e & 1)
+        {
+            temp = karazMult(&res, &factor);
+            bignumFree(&res);
+            res = temp;
+        }
+        e >>= 1;
+        if (e > 0)
+        {
+            temp = karazMult(&factor, &factor);
+            bignumFree(&factor);
+            factor = temp;
+        }
+    }
+    bignumFree(&factor);
+    return res;
+}
+
+/*
+ * Adds the n blocks of y to the n blocks of x and stores them in r, which may be x or y; returns the carry out of the top block
  */
-void bignumPrintDec(const struct bignum *x, size_t totalDigits)
+uint32_t blocksAdd(uint32_t *r, const uint32_t *x, const uint32_t *y, size_t n)
 {
-    size_t len = x->length;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t t = (uint64_t)x[i] + y[i] + carry;
+        r[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    return (uint32_t)carry;
+}
+
+/*
+ * Writes value to stream as 8 bytes in little-endian order, whatever the byte order of the machine; returns false if writing fails
+ */
+bool streamWrite64(FILE *stream, uint64_t value)
+{
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return fwrite(bytes, 1, 8, stream) == 8;
+}
+
+/*
+ * Reads a value written by streamWrite64 from stream; returns false if reading fails
+ */
+bool streamRead64(FILE *stream, uint64_t *value)
+{
+    unsigned char bytes[8];
+    if (fread(bytes, 1, 8, stream) != 8)
+    {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < 8; i++)
+    {
+        *value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+/*
+ * Writes the bignum in binary limb format to stream: length and subone as 64 bit values followed by the blocks, every value in
+ * little-endian order byte by byte, so that the format is the same on every machine
+ * Returns false if writing fails
+ */
+bool bignumWrite(FILE *stream, const struct bignum *num)
+{
+    if (!streamWrite64(stream, num->length) || !streamWrite64(stream, num->subone))
+    {
+        return false;
+    }
+
+    unsigned char bytes[STREAM_CHUNK];
+    for (size_t done = 0; done < num->length;)
+    {
+        size_t count = num->length - done < STREAM_CHUNK / 4 ? num->length - done : STREAM_CHUNK / 4;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t block = num->numbers[done + i];
+            bytes[4 * i] = (unsigned char)block;
+            bytes[4 * i + 1] = (unsigned char)(block >> 8);
+            bytes[4 * i + 2] = (unsigned char)(block >> 16);
+            bytes[4 * i + 3] = (unsigned char)(block >> 24);
+        }
+        if (fwrite(bytes, 4, count, stream) != count)
+        {
+            return false;
+        }
+        done += count;
+    }
+    return true;
+}
+
+/*
+ * Reads a bignum written by bignumWrite from stream into num
+ * Returns false if reading fails or the header is inconsistent, num is left without allocated memory in that case
+ */
+bool bignumRead(FILE *stream, struct bignum *num)
+{
+    uint64_t length, subone;
+
+    if (!streamRead64(stream, &length) || !streamRead64(stream, &subone) || length == 0 || length > SIZE_MAX / sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    num->length = length;
+    num->subone = subone;
+    num->numbers = limbsAlloc(num->length + 1);
+
+    unsigned char bytes[STREAM_CHUNK];
+    for (size_t done = 0; done < num->length;)
+    {
+        size_t count = num->length - done < STREAM_CHUNK / 4 ? num->length - done : STREAM_CHUNK / 4;
+        if (fread(bytes, 4, count, stream) != count)
+        {
+            limbsFree(num->numbers);
+            return false;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            num->numbers[done + i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 | (uint32_t)bytes[4 * i + 2] << 16
+                | (uint32_t)bytes[4 * i + 3] << 24;
+        }
+        done += count;
+    }
+    return true;
+}
+
+/*
+ * Prints count decimal places of the fraction held in the frac_len blocks of num, which get overwritten
+ * Every multiplication by 10^9 = 2^9 * 5^9 moves the next nine places in front of the comma and adds nine zero bits at the bottom,
+ * blocks below low are zero and get skipped
+ */
+static void printFraction(FILE *stream, uint32_t *num, size_t frac_len, size_t totalDigits)
+{
+    size_t low = 0;
+    progressBegin(PHASE_OUTPUT, totalDigits);
+    for (size_t done = 0; done < totalDigits; done += 9)
+    {
+        progressStep(done);
+        while (low < frac_len && num[low] == 0)
+        {
+            low++;
+        }
+        uint32_t group = blocksMul1(num + low, num + low, frac_len - low, 1000000000);
+
+        // Only the leading places of the last group are printed
+        size_t count = totalDigits - done < 9 ? totalDigits - done : 9;
+        for (size_t i = count; i < 9; i++)
+        {
+            group /= 10;
+        }
+        fprintf(stream, "%0*" PRIu32 "", (int)count, group);
+    }
+}
+
+/*
+ * print bignum in decimal values with totalDigits places after the comma to stream
+ * The integer part gets converted by repeated division by 10^9, the subone places by repeated multiplication by 10^9,
+ * which moves the next nine places in front of the comma; both yield nine places per pass over the blocks
+ */
+void bignumPrintDec(FILE *stream, const struct bignum *x, size_t totalDigits)
+{
+    size_t int_len = x->length > x->subone ? x->length - x->subone : 0;
+    size_t frac_len = x->subone;
+
+    uint32_t *num = limbsAlloc(int_len + 1);
+    for (size_t i = 0; i < int_len; i++)
+    {
+        num[i] = x->numbers[x->subone + i];
+    }
+
+    // Every 32 bit block holds less than ten decimal places, the places are collected starting with the lowest
+    uint8_t *buffer = contextAlloc(10 * int_len + 9);
     size_t bufcounter = 0;
+    size_t len = int_len;
+    do
+    {
+        uint32_t group = blocksDivrem1(num, num, len, 1000000000);
+        while (len > 0 && num[len - 1] == 0)
+        {
+            len--;
+        }
+        for (int i = 0; i < 9; i++)
+        {
+            buffer[bufcounter++] = group % 10;
+            group /= 10;
+        }
+    } while (len > 0);
 
-    uint8_t *buffer = (uint8_t *)calloc(totalDigits, sizeof(uint8_t));
-    uint32_t *num = (uint32_t *)calloc(len, sizeof(u_int32_t));
-    uint32_t *num2 = (uint32_t *)calloc(len, sizeof(u_int32_t));
-    bignumCopy(x, num);
+    // At least one place before the comma, without leading zeroes
+    while (bufcounter > 1 && buffer[bufcounter - 1] == 0)
+    {
+        bufcounter--;
+    }
+    for (size_t i = bufcounter; i > 0; i--)
+    {
+        fprintf(stream, "%" PRIu8 "", buffer[i - 1]);
+    }
+    contextFree(buffer);
+    limbsFree(num);
 
-    while (1)
+    if (totalDigits > 0)
     {
-        binaryConverter(buffer, num, num2, bufcounter++, len);
-        if (bufcounter == totalDigits)
-            break;
+        fprintf(stream, ",");
+    }
 
-        binaryConverter(buffer, num2, num, bufcounter++, len);
-        if (bufcounter == totalDigits)
-            break;
+    num = limbsAlloc(frac_len + 1);
+    for (size_t i = 0; i < frac_len && i < x->length; i++)
+    {
+        num[i] = x->numbers[i];
     }
+    printFraction(stream, num, frac_len, totalDigits);
+    fprintf(stream, "\n");
 
-    for (int i = totalDigits - 1; i >= 0; i--)
+    limbsFree(num);
+}
+
+/*
+ * Prints only the decimal places from + 1 to from + count after the comma of x, without the integer part and the comma
+ * The fraction gets multiplied by 10^from with karazMult, which moves the skipped places in front of the comma where they are
+ * dropped; only the upper blocks of the remaining fraction are needed for count places, so the conversion scales with the window
+ */
+void bignumPrintDecWindow(FILE *stream, const struct bignum *x, size_t from, size_t count)
+{
+    if ((double)x->subone * 32 < (double)(from + count) * log2(10))
     {
-        printf("%" PRIu8 "", buffer[i]);
+        contextFail(SQRT2_EPRECISION, "DEBUG: bignumPrintDecWindow cannot print more precise than the number actually is!");
+    }
+
+    struct bignum frac;
+    frac.length = x->subone > 0 ? x->subone : 1;
+    frac.subone = 0;
+    frac.numbers = limbsAlloc(frac.length + 1);
+    for (size_t i = 0; i < x->subone && i < x->length; i++)
+    {
+        frac.numbers[i] = x->numbers[i];
+    }
+
+    struct bignum power = bignumPow(10, from);
+    struct bignum shifted = karazMult(&frac, &power);
+    bignumFree(&power);
+    bignumFree(&frac);
+
+    // Every place needs log2(10) / 32 blocks, two more keep the truncated blocks from reaching the last place
+    size_t keep = (size_t)ceil(count * log2(10) / 32) + 2;
+    if (keep > x->subone)
+    {
+        keep = x->subone;
+    }
+    uint32_t *num = limbsAlloc(keep + 1);
+    for (size_t i = 0; i < keep; i++)
+    {
+        size_t block = x->subone - keep + i;
+        num[i] = block < shifted.length ? shifted.numbers[block] : 0;
+    }
+    bignumFree(&shifted);
+
+    printFraction(stream, num, keep, count);
+    fprintf(stream, "\n");
+    limbsFree(num);
+}
+
+/*
+ * Prints only the hexadecimal places from + 1 to from + count after the comma of num, without the integer part and the comma
+ * Every place is read directly from its block, so the cost only depends on count
+ */
+void printHexWindow(FILE *stream, const struct bignum *num, size_t from, size_t count)
+{
+    if (from + count > num->subone * 8)
+    {
+        contextFail(SQRT2_EPRECISION, "DEBUG: printHexWindow cannot print more precise than the number actually is!");
     }
-    printf("\n");
 
-    free(buffer);
-    free(num);
-    free(num2);
+    static const char hex_digits[] = "0123456789abcdef";
+    for (size_t place = from; place < from + count; place++)
+    {
+        // Place 0 is the highest nibble of the highest subone block
+        uint32_t block = num->numbers[num->subone - 1 - place / 8];
+        putc(hex_digits[(block >> (28 - 4 * (place % 8))) & 0xf], stream);
+    }
+    fprintf(stream, "\n");
 }
 
 /*
- * Prints bignum as hexadecimal number up to desired precision
- * Terminates the program immeadiatly if the given precision is higher than the amount of subone places of the number
+ * Prints bignum as hexadecimal number up to desired precision to stream
+ * Fails the running library call, or terminates the program, if the given precision is higher than the amount of subone places of the number
  */
-void printResultHex(const struct bignum *num, size_t prec)
+void printResultHex(FILE *stream, const struct bignum *num, size_t prec)
 {
     size_t whole_blocks = prec / 8;
     prec %= 8;
 
     if (whole_blocks > num->subone || (whole_blocks == num->subone && prec != 0))
     {
-        fprintf(stderr, "DEBUG: printResult cannot print more precise than the number actually is!");
-        exit(EXIT_FAILURE);
+        contextFail(SQRT2_EPRECISION, "DEBUG: printResult cannot print more precise than the number actually is!");
     }
 
     bool comma_set = false;
@@ -118,16 +438,16 @@ void printResultHex(const struct bignum *num, size_t prec)
         // Printing the highest significant places without leading zeroes, if they are not subone
         if ((size_t)i == num->length - 1 && num->subone < num->length)
         {
-            printf("%x", num->numbers[num->length - 1]);
+            fprintf(stream, "%x", num->numbers[num->length - 1]);
         }
         else
         {
             if (num->subone - 1 == (size_t)i)
             {
-                printf(",");
+                fprintf(stream, ",");
                 comma_set = true;
             }
-            printf("%08x", num->numbers[i]);
+            fprintf(stream, "%08x", num->numbers[i]);
         }
     }
 
@@ -135,11 +455,12 @@ void printResultHex(const struct bignum *num, size_t prec)
     {
         if (!comma_set)
         {
-            printf(",");
+            fprintf(stream, ",");
         }
-        printf("%x", num->numbers[num->subone - whole_blocks - 1] >> (32 - prec * 4));
+        // The remaining places keep their leading zeroes, since they are subone
+        fprintf(stream, "%0*x", (int)prec, num->numbers[num->subone - whole_blocks - 1] >> (32 - prec * 4));
     }
-    printf("\n");
+    fprintf(stream, "\n");
 }
 
 /*
@@ -151,8 +472,7 @@ void bignumDec(struct bignum *x)
     bool done = false;
     if (x->subone > 0)
     {
-        fprintf(stderr, "DEBUG: bignumDec is not meant for non integer values!\n");
-        exit(EXIT_FAILURE);
+        contextFail(SQRT2_EINTERNAL, "DEBUG: bignumDec is not meant for non integer values!\n");
     }
 
     // Subtracts one until the first block that isn't one is reached
@@ -172,6 +492,8 @@ void bignumDec(struct bignum *x)
  */
 struct bignum bignumAdd(struct bignum *x, struct bignum *y)
 {
+    statsOp(OP_ADD, x->length > y->length ? x->length : y->length);
+
     // Stores the bigger length/subone value of the two arguments, used later to make sure that the result can hold the new number
     size_t greater_length = x->length > y->length ? x->length : y->length;
     size_t greater_subone = x->subone > y->subone ? x->subone : y->subone;
@@ -182,12 +504,7 @@ struct bignum bignumAdd(struct bignum *x, struct bignum *y)
      * Allocates enough memory for the values even if one block has more values smaller than one + one additional block for potential carry
      * Will allocate more memory than needed in some cases, but assures that there is enough
      */
-    res.numbers = calloc(greater_length + greater_subone + 1, sizeof(uint32_t));
-    if (res.numbers == NULL)
-    {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
-    }
+    res.numbers = limbsAlloc(greater_length + greater_subone + 1);
     res.length = 0;
 
     /* The result of the individual 32 bit block addittions gets stored in the variable sum,
@@ -285,6 +602,8 @@ struct bignum bignumAdd(struct bignum *x, struct bignum *y)
  */
 struct bignum bignumSub(struct bignum *x, struct bignum *y)
 {
+    statsOp(OP_SUB, x->length > y->length ? x->length : y->length);
+
     // Stores the bigger length/subone value of the two arguments, used later to make sure that the result can hold the new number
     size_t greater_length = x->length > y->length ? x->length : y->length;
     size_t greater_subone = x->subone > y->subone ? x->subone : y->subone;
@@ -295,18 +614,11 @@ struct bignum bignumSub(struct bignum *x, struct bignum *y)
      * Allocates enough memory for the values even if one block has more values smaller than one
      * Will allocate more memory than needed in some cases, but assures that there is enough
      */
-    res.numbers = calloc(greater_length + greater_subone, sizeof(uint32_t));
-    if (res.numbers == NULL)
-    {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
-    }
+    res.numbers = limbsAlloc(greater_length + greater_subone);
 
     // least_significant indicates if there has been a value that is not zero stored in a sub one block
     bool least_significant = true;
-    bool carry = false;
-    // y_more_prec tracks the carry status if y has more subone blocks than x
-    bool y_more_prec = false;
+    bool borrow = false;
 
     // offset is used to count the number of unnecassary sub one blocks
     size_t offset = 0;
@@ -316,63 +628,23 @@ struct bignum bignumSub(struct bignum *x, struct bignum *y)
     // final_length tracks the highest block that isn't zero after the subtraction; if every block is zero the variable is one to represent the lowest possible length
     size_t final_length = 1;
 
-    size_t x_index = 0;
-    size_t y_index = 0;
+    // Blocks of the number with less sub one places start later, their shift aligns blocks of the same significance
+    size_t x_shift = greater_subone - x->subone;
+    size_t y_shift = greater_subone - y->subone;
+    size_t total = x->length + x_shift > y->length + y_shift ? x->length + x_shift : y->length + y_shift;
 
-    for (size_t i = 0; x_index < x->length || y_index < y->length; i++)
+    for (size_t i = 0; i < total; i++)
     {
-        if (x_index >= x->length)
-        {
-            diff = 0 - y->numbers[y_index];
-            y_index++;
-        }
-        else if (y_index >= y->length)
-        {
-            diff = x->numbers[x_index];
+        uint32_t x_val = i >= x_shift && i - x_shift < x->length ? x->numbers[i - x_shift] : 0;
+        uint32_t y_val = i >= y_shift && i - y_shift < y->length ? y->numbers[i - y_shift] : 0;
 
-            x_index++;
-        }
-        else
-        {
-            // Makes sure that only blocks of the same significance get subtracted
-            if (x->subone > y->subone && x->subone > y->subone + x_index)
-            {
-                diff = x->numbers[x_index];
+        diff = x_val - y_val - borrow;
 
-                x_index++;
-            }
-            else if (x->subone < y->subone && y->subone > x->subone + y_index)
-            {
-                y_more_prec = true;
-
-                diff = 0 - y->numbers[y_index];
-
-                y_index++;
-            }
-            else
-            {
-                diff = x->numbers[x_index] - y->numbers[y_index];
-
-                x_index++;
-                y_index++;
-            }
-        }
-
-        if (carry)
-        {
-            diff--;
-            carry = false;
-        }
-
-        // Carry gets set if there is an underflow or if y_more_prec is set
-        if ((x_index > 0 && diff > x->numbers[x_index - 1]) || y_more_prec)
-        {
-            carry = true;
-            y_more_prec = false;
-        }
+        // A borrow is needed if the subtrahend (including the previous borrow) exceeds the minuend
+        borrow = (uint64_t)y_val + borrow > (uint64_t)x_val;
 
         // If the difference of two sub one blocks is zero and no block before was not zero the value of the new block gets omitted
-        if (least_significant && i < greater_subone && diff % 0x100000000 == 0)
+        if (least_significant && i < greater_subone && diff == 0)
         {
             offset++;
             continue;
@@ -433,12 +705,7 @@ struct bignum rShift(struct bignum *x, size_t n)
     // Determines if there are additional subone blocks needed
     size_t overfill = blocks_shifted > x->length ? blocks_shifted - x->length : 0;
 
-    res.numbers = calloc((x->length + overfill + 1), sizeof(uint32_t));
-    if (res.numbers == NULL)
-    {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
-    }
+    res.numbers = limbsAlloc((x->length + overfill + 1));
 
     uint32_t val = 0;
 
@@ -514,12 +781,7 @@ void lShift32(struct bignum *x, size_t n)
         n = x->subone > n ? 0 : n - subone;
     }
 
-    x->numbers = realloc(x->numbers, (x->length + n) * sizeof(uint32_t));
-    if (x->numbers == NULL)
-    {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
-    }
+    x->numbers = limbsRealloc(x->numbers, x->length + n);
 
     if (n > 0)
     {
@@ -534,7 +796,36 @@ void lShift32(struct bignum *x, size_t n)
             x->numbers[i] = 0;
         }
     }
-    x->numbers[x->length + n - 1] != 0 ? x->length += n : 1;
+    // A zero stays a single block, any other number keeps its leading zero blocks and grows by n
+    if (!(x->length == 1 && x->numbers[n] == 0))
+    {
+        x->length += n;
+    }
+}
+
+/*
+ * Shifts the numbers of the given integer bignum to the right by n blocks, dropping the n least significant blocks
+ * Leaves a single zero block if every block gets dropped
+ */
+void rShift32(struct bignum *x, size_t n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    if (n >= x->length)
+    {
+        x->numbers[0] = 0;
+        x->length = 1;
+        return;
+    }
+
+    for (size_t i = 0; i < x->length - n; i++)
+    {
+        x->numbers[i] = x->numbers[i + n];
+    }
+    x->length -= n;
 }
 
 /*
@@ -546,12 +837,7 @@ void copy(struct bignum *x, struct bignum *y, int begin, int end)
     y->length = 0;
     y->subone = 0;
 
-    y->numbers = calloc(end - begin + 2, sizeof(uint32_t));
-    if (y->numbers == NULL)
-    {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
-    }
+    y->numbers = limbsAlloc(end - begin + 2);
 
     for (int i = 0; i <= end - begin; i++)
     {
@@ -579,6 +865,18 @@ void cutToSize(struct bignum *num, size_t prec)
     }
 }
 
+/*
+ * Cuts the bignum down to prec binary subone places, clearing the places below prec in the last kept block
+ */
+void cutToBits(struct bignum *num, size_t prec)
+{
+    cutToSize(num, (prec + 31) / 32);
+    if (prec % 32 != 0 && num->subone > 0)
+    {
+        num->numbers[0] = (num->numbers[0] >> (32 - prec % 32)) << (32 - prec % 32);
+    }
+}
+
 /*
  * Aligns two number arrays to same length by 0-extending the smaller one.
  * Assures that both arrays are of an even length using 0-extension.
@@ -611,12 +909,7 @@ void karazMultPreparation(struct bignum *x, struct bignum *y)
     {
         // y->numbers has to be 0-extended
         // allocating memory for the 0's
-        y->numbers = (uint32_t *)realloc(y->numbers, (y->length + offset + 1) * sizeof(uint32_t));
-        if (y->numbers == NULL)
-        {
-            fprintf(stderr, "Error while allocation memory!");
-            exit(EXIT_FAILURE);
-        }
+        y->numbers = limbsRealloc(y->numbers, y->length + offset + 1);
         while (offset > 0)
         {
             // extending and setting length
@@ -629,12 +922,7 @@ void karazMultPreparation(struct bignum *x, struct bignum *y)
     {
         // x->numbers has to be 0-extended
         // allocating memory for the 0's
-        x->numbers = (uint32_t *)realloc(x->numbers, ((int32_t)x->length - offset + 1) * sizeof(uint32_t));
-        if (x->numbers == NULL)
-        {
-            fprintf(stderr, "Error while allocation memory!");
-            exit(EXIT_FAILURE);
-        }
+        x->numbers = limbsRealloc(x->numbers, (int32_t)x->length - offset + 1);
         while (offset < 0)
         {
             x->numbers[x->length] = 0x00000000;
@@ -643,9 +931,10 @@ void karazMultPreparation(struct bignum *x, struct bignum *y)
         }
     }
 
-    // aligning to the even length
+    // aligning to the even length, lShift32 leaves no spare block so the memory has to be extended first
     if ((x->length % 2) == 1)
     {
+        x->numbers = limbsRealloc(x->numbers, x->length + 1);
         x->length++;
 
         // extending and setting length
@@ -654,6 +943,7 @@ void karazMultPreparation(struct bignum *x, struct bignum *y)
 
     if ((y->length % 2) == 1)
     {
+        y->numbers = limbsRealloc(y->numbers, y->length + 1);
         y->length++;
 
         y->numbers[y->length - 1] = 0x00000000;
@@ -661,27 +951,362 @@ void karazMultPreparation(struct bignum *x, struct bignum *y)
 }
 
 /*
- * Multiplies two bignums with karazuba multiplication
- * Recursively splits the bignums in two until there are only one 32 bit blocks left, that can be multiplied regularly,
- * if one bignum uses more blocks, has greater precision or has an odd number of blocks the bignum gets zero extended until both have an equal and even amount of blocks
+ * Compares two bignums, which may have different amounts of subone blocks; returns -1, 0 or 1 if x is smaller, equal or greater than y
  */
-struct bignum karazMult(struct bignum *x, struct bignum *y)
+int bignumCompare(const struct bignum *x, const struct bignum *y)
 {
-    // recursion base case: multiplication when both lengths are 1
-    if ((x->length == 1) && (y->length == 1))
+    // Blocks are compared by significance, block i of a number has the significance i - subone
+    long top = (long)x->length - (long)x->subone > (long)y->length - (long)y->subone ? (long)x->length - (long)x->subone : (long)y->length - (long)y->subone;
+    long bottom = -(long)(x->subone > y->subone ? x->subone : y->subone);
+
+    for (long i = top - 1; i >= bottom; i--)
     {
-        struct bignum res;
+        long x_index = i + (long)x->subone;
+        long y_index = i + (long)y->subone;
+        uint32_t x_val = x_index >= 0 && x_index < (long)x->length ? x->numbers[x_index] : 0;
+        uint32_t y_val = y_index >= 0 && y_index < (long)y->length ? y->numbers[y_index] : 0;
 
-        if (x->numbers[0] == 0 || y->numbers[0] == 0)
+        if (x_val != y_val)
         {
-            bignumInit(&res, 0);
-            return res;
+            return x_val < y_val ? -1 : 1;
         }
+    }
+    return 0;
+}
+
+/*
+ * Returns the residue of the blocks of x modulo 2^32 - 1
+ * Since 2^32 is one modulo 2^32 - 1 the residue does not depend on the amount of subone blocks, so the residue of a product
+ * is the product of the residues of its factors no matter how the multiplication placed the comma
+ */
+uint32_t bignumResidue(const struct bignum *x)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < x->length; i++)
+    {
+        sum += x->numbers[i];
+        sum = (sum & 0xffffffff) + (sum >> 32);
+    }
+    return sum == 0xffffffff ? 0 : (uint32_t)sum;
+}
+
+/*
+ * Checks the product of x and y by comparing the residues modulo 2^32 - 1, catches most errors at a linear cost
+ */
+bool residueCheck(const struct bignum *x, const struct bignum *y, const struct bignum *product)
+{
+    return (uint64_t)bignumResidue(x) * bignumResidue(y) % 0xffffffff == bignumResidue(product);
+}
+
+/*
+ * Returns the operand length up to which karazMult multiplies directly, the crossover of the selected kernel unless the tuning sets one
+ */
+static size_t multBasecase(void)
+{
+    size_t basecase = contextTuning()->mult_basecase;
+    return basecase != 0 ? basecase : kernelCurrent()->basecase;
+}
+
+/*
+ * Multiplies two bignums block by block, the result has the sum of the subone blocks of both operands
+ * Used by karazMult for short operands, where splitting costs more than the additional block products
+ */
+struct bignum basecaseMult(const struct bignum *x, const struct bignum *y)
+{
+    struct bignum res;
+    res.length = x->length + y->length;
+    res.subone = x->subone + y->subone;
+    res.numbers = limbsAlloc(res.length + 1);
+
+    // The block products are left to the kernel selected for this processor
+    statsProducts((uint64_t)x->length * y->length);
+    kernelCurrent()->mult(res.numbers, x->numbers, x->length, y->numbers, y->length);
+
+    // Removing leading zero blocks above the comma
+    while (res.length > 1 && res.length > res.subone && res.numbers[res.length - 1] == 0)
+    {
+        res.length--;
+    }
+    return res;
+}
+
+/*
+ * Squares a bignum block by block: every product of two different blocks is needed twice, so only the products above the diagonal
+ * get summed up and doubled by a shift before the squares of the single blocks are added
+ */
+struct bignum basecaseSqr(const struct bignum *x)
+{
+    size_t n = x->length;
+    struct bignum res;
+    res.length = 2 * n;
+    res.subone = 2 * x->subone;
+    res.numbers = limbsAlloc(res.length + 1);
+    statsProducts((uint64_t)n * (n + 1) / 2);
 
-        uint64_t product = ((uint64_t)x->numbers[0]) * ((uint64_t)y->numbers[0]);
-        bignumInit(&res, product);
-        res.subone = x->subone + y->subone;
-        return res;
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        res.numbers[i + n] = blocksAddmul1(res.numbers + 2 * i + 1, x->numbers + i + 1, n - i - 1, x->numbers[i]);
+    }
+
+    // The sum above the diagonal is less than half of the square, so the shift cannot overflow
+    for (size_t i = res.length - 1; i > 0; i--)
+    {
+        res.numbers[i] = res.numbers[i] << 1 | res.numbers[i - 1] >> 31;
+    }
+    res.numbers[0] <<= 1;
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t square = (uint64_t)x->numbers[i] * x->numbers[i];
+        uint64_t t = (uint64_t)res.numbers[2 * i] + (uint32_t)square + carry;
+        res.numbers[2 * i] = (uint32_t)t;
+        t = (uint64_t)res.numbers[2 * i + 1] + (square >> 32) + (t >> 32);
+        res.numbers[2 * i + 1] = (uint32_t)t;
+        carry = t >> 32;
+    }
+
+    // Removing leading zero blocks above the comma
+    while (res.length > 1 && res.length > res.subone && res.numbers[res.length - 1] == 0)
+    {
+        res.length--;
+    }
+    return res;
+}
+
+/*
+ * Squares a bignum, the result has twice the subone blocks of x
+ * Splits x = x1 * 2^32m + x0 and computes x^2 = x1^2 * 2^64m + ((x0 + x1)^2 - x0^2 - x1^2) * 2^32m + x0^2 from three squares of half the length,
+ * where karazMult would copy and pad both operands and compute three general products
+ */
+struct bignum bignumSqr(struct bignum *x)
+{
+    statsOp(OP_MULT, x->length);
+
+    // The square rows need about half of the block products of the scalar kernel, so they stay faster up to twice the length,
+    // the vector kernels compute the full product faster than the rows
+    if (!kernelCurrent()->vector && x->length <= 2 * multBasecase())
+    {
+        return basecaseSqr(x);
+    }
+    if (x->length <= multBasecase())
+    {
+        return basecaseMult(x, x);
+    }
+
+    size_t half = x->length / 2;
+    struct bignum x0, x1;
+    copy(x, &x0, 0, half - 1);
+    copy(x, &x1, half, x->length - 1);
+
+    struct bignum mx = bignumAdd(&x0, &x1);
+
+    // Used to temporally store the result of the operations in order to retain the pointers of the operands so they can be freed
+    struct bignum temp;
+
+    temp = bignumSqr(&mx);
+    bignumFree(&mx);
+    mx = temp;
+
+    temp = bignumSqr(&x0);
+    bignumFree(&x0);
+    x0 = temp;
+
+    temp = bignumSqr(&x1);
+    bignumFree(&x1);
+    x1 = temp;
+
+    // (x0 + x1)^2 - x0^2 - x1^2 = 2 * x0 * x1
+    temp = bignumSub(&mx, &x0);
+    bignumFree(&mx);
+    mx = temp;
+
+    temp = bignumSub(&mx, &x1);
+    bignumFree(&mx);
+    mx = temp;
+
+    lShift32(&mx, half);
+    lShift32(&x1, 2 * half);
+
+    temp = bignumAdd(&mx, &x0);
+    bignumFree(&mx);
+    mx = temp;
+
+    temp = bignumAdd(&mx, &x1);
+    bignumFree(&mx);
+    mx = temp;
+
+    bignumFree(&x0);
+    bignumFree(&x1);
+
+    mx.subone = 2 * x->subone;
+    if (mx.subone > mx.length)
+    {
+        mx.numbers = limbsRealloc(mx.numbers, mx.subone);
+
+        for (size_t i = mx.length; i < mx.subone; i++)
+        {
+            mx.numbers[i] = 0;
+        }
+        mx.length = mx.subone;
+    }
+    return mx;
+}
+
+/*
+ * Adds the integer x shifted left by pos blocks to the integer acc in place, acc must have room for the sum within its length
+ * Leading zero blocks of x beyond the length of acc are ignored
+ */
+void bignumAddAt(struct bignum *acc, size_t pos, const struct bignum *x)
+{
+    size_t length = x->length < acc->length - pos ? x->length : acc->length - pos;
+    uint32_t carry = blocksAdd(acc->numbers + pos, acc->numbers + pos, x->numbers, length);
+    for (size_t i = pos + length; carry != 0 && i < acc->length; i++)
+    {
+        acc->numbers[i]++;
+        carry = acc->numbers[i] == 0;
+    }
+}
+
+/*
+ * Adds the product of x and y to acc in place, for the sums of products in the merges of the binary splitting
+ * Short operands are multiplied row by row straight into acc and long ones chunk by chunk, so at most one product of the size of the
+ * chunks exists besides acc; balanced products are computed by karazMult and added, which still saves the third number a separate sum needs
+ * All three numbers have to be integers, otherwise the product is added with bignumAdd
+ */
+void bignumAddMult(struct bignum *acc, struct bignum *x, struct bignum *y)
+{
+    if (acc->subone != 0 || x->subone != 0 || y->subone != 0)
+    {
+        struct bignum product = karazMult(x, y);
+        struct bignum sum = bignumAdd(acc, &product);
+        bignumFree(&product);
+        bignumFree(acc);
+        *acc = sum;
+        return;
+    }
+
+    // The shorter operand is y
+    if (x->length < y->length)
+    {
+        struct bignum *swap = x;
+        x = y;
+        y = swap;
+    }
+
+    // One block more than the longer of both summands holds the carry
+    size_t length = (acc->length > x->length + y->length ? acc->length : x->length + y->length) + 1;
+    acc->numbers = limbsRealloc(acc->numbers, length + 1);
+    for (size_t i = acc->length; i < length; i++)
+    {
+        acc->numbers[i] = 0;
+    }
+    acc->length = length;
+
+    // The rows are scalar, with a vector kernel the products of the other branches are faster
+    if (!kernelCurrent()->vector && y->length <= multBasecase())
+    {
+        statsOp(OP_MULT, x->length);
+        statsProducts((uint64_t)x->length * y->length);
+        for (size_t i = 0; i < y->length; i++)
+        {
+            // Unlike in basecaseMult the block above the row already holds a part of the sum, so the carry gets added
+            uint32_t carry = blocksAddmul1(acc->numbers + i, x->numbers, x->length, y->numbers[i]);
+            struct bignum carry_block = {&carry, 1, 0};
+            bignumAddAt(acc, i + x->length, &carry_block);
+        }
+    }
+    else if (x->length >= 2 * y->length)
+    {
+        struct bignum chunk;
+        chunk.subone = 0;
+        for (size_t pos = 0; pos < x->length; pos += y->length)
+        {
+            chunk.numbers = x->numbers + pos;
+            chunk.length = x->length - pos < y->length ? x->length - pos : y->length;
+
+            struct bignum product = karazMult(&chunk, y);
+            bignumAddAt(acc, pos, &product);
+            bignumFree(&product);
+        }
+    }
+    else
+    {
+        struct bignum product = karazMult(x, y);
+        bignumAddAt(acc, 0, &product);
+        bignumFree(&product);
+    }
+
+    while (acc->length > 1 && acc->numbers[acc->length - 1] == 0)
+    {
+        acc->length--;
+    }
+}
+
+/*
+ * Multiplies the long operand x by the short operand y by slicing x into chunks of the length of y,
+ * each chunk is multiplied by y as a balanced product and added into the result at the position of the chunk
+ * The result has the sum of the subone blocks of both operands
+ */
+struct bignum unbalancedMult(const struct bignum *x, const struct bignum *y)
+{
+    struct bignum res;
+    res.length = x->length + y->length;
+    res.subone = x->subone + y->subone;
+    res.numbers = limbsAlloc(res.length + 1);
+
+    // Both operands are multiplied as integers, the chunks are views into the blocks of x
+    struct bignum factor = {y->numbers, y->length, 0};
+    struct bignum chunk;
+    chunk.subone = 0;
+
+    for (size_t pos = 0; pos < x->length; pos += y->length)
+    {
+        chunk.numbers = x->numbers + pos;
+        chunk.length = x->length - pos < y->length ? x->length - pos : y->length;
+
+        struct bignum product = karazMult(&chunk, &factor);
+        bignumAddAt(&res, pos, &product);
+        bignumFree(&product);
+    }
+
+    // Removing leading zero blocks above the comma
+    while (res.length > 1 && res.length > res.subone && res.numbers[res.length - 1] == 0)
+    {
+        res.length--;
+    }
+    return res;
+}
+
+/*
+ * Multiplies two bignums with karazuba multiplication, squares are handed to bignumSqr
+ * Recursively splits the bignums in two until the shorter one has at most mult_basecase blocks, those get multiplied by basecaseMult,
+ * if one bignum uses more blocks, has greater precision or has an odd number of blocks the bignum gets zero extended until both have an equal and even amount of blocks
+ */
+struct bignum karazMult(struct bignum *x, struct bignum *y)
+{
+    // Squares take the cheaper path
+    if (x == y || (x->numbers == y->numbers && x->length == y->length && x->subone == y->subone))
+    {
+        return bignumSqr(x);
+    }
+
+    statsOp(OP_MULT, x->length > y->length ? x->length : y->length);
+
+    // recursion base case: multiplying directly when one of the operands is short
+    if (x->length <= multBasecase() || y->length <= multBasecase())
+    {
+        return basecaseMult(x, y);
+    }
+
+    // Operands of very different length get sliced instead of padding the shorter one to the length of the longer one
+    if (x->length >= 2 * y->length)
+    {
+        return unbalancedMult(x, y);
+    }
+    if (y->length >= 2 * x->length)
+    {
+        return unbalancedMult(y, x);
     }
 
     struct bignum x_cpy, y_cpy;
@@ -759,12 +1384,7 @@ struct bignum karazMult(struct bignum *x, struct bignum *y)
     mx.subone = x->subone > y->subone ? 2 * x->subone : 2 * y->subone;
     if (mx.subone > mx.length)
     {
-        mx.numbers = realloc(mx.numbers, mx.subone * sizeof(uint32_t));
-        if (mx.numbers == NULL)
-        {
-            fprintf(stderr, "Error while allocation memory!");
-            exit(EXIT_FAILURE);
-        }
+        mx.numbers = limbsRealloc(mx.numbers, mx.subone);
 
         for (size_t i = mx.length; i < mx.subone; i++)
         {
@@ -790,8 +1410,7 @@ size_t reduce(struct bignum *x, struct bignum *dest)
 {
     if (x->subone > 0)
     {
-        fprintf(stderr, "DEBUG: reduce is not meant for non integer values!\n");
-        exit(EXIT_FAILURE);
+        contextFail(SQRT2_EINTERNAL, "DEBUG: reduce is not meant for non integer values!\n");
     }
 
     // Sets all blocks in bignum to subone, then shifts left until the most significant sub one bit is set resulting in a number between 0.5 and 1
@@ -806,12 +1425,7 @@ size_t reduce(struct bignum *x, struct bignum *dest)
         // Offset is the number of unnecessary blocks omitted
         size_t offset = 0;
 
-        dest->numbers = calloc(x->length, sizeof(uint32_t));
-        if (dest->numbers == NULL)
-        {
-            fprintf(stderr, "Error while allocation memory!");
-            exit(EXIT_FAILURE);
-        }
+        dest->numbers = limbsAlloc(x->length);
 
         // Buffer is equal to the bits lost in a block by shifting left, buffer gets added to the next block to restore the value
         uint32_t buffer = 0;
@@ -862,9 +1476,32 @@ size_t reduce(struct bignum *x, struct bignum *dest)
 }
 
 /*
- * Calculates quotient D/N with the precison of prec using Newton-Raphson division
+ * Returns the number of significant bits of the given integer bignum
  */
-struct bignum newtonDiv(struct bignum *N, struct bignum *D, size_t prec)
+size_t bignumBitLength(const struct bignum *x)
+{
+    size_t length = x->length;
+    while (length > 1 && x->numbers[length - 1] == 0)
+    {
+        length--;
+    }
+
+    size_t bits = 32 * length;
+    uint32_t top = x->numbers[length - 1];
+    while (bits > 0 && (top & 0x80000000) == 0)
+    {
+        top <<= 1;
+        bits--;
+    }
+    return bits;
+}
+
+/*
+ * Calculates the reciprocal of d (0.5 <= d < 1) with the precison of prec using Newton-Raphson iterations
+ * Starts from seed if it is given, which has to be precise to seed_prec binary places, otherwise from 48/17 - 32/17 * d
+ * The iterations run on fixed point numbers, so cutting the products down to the considered blocks does not move any blocks
+ */
+static struct fixed fixedReciprocal(const struct fixed *d, size_t prec, const struct bignum *seed, size_t seed_prec)
 {
     // Number of considered blocks needed to assure the required precision
     size_t cons_blocks = prec / 32;
@@ -872,84 +1509,130 @@ struct bignum newtonDiv(struct bignum *N, struct bignum *D, size_t prec)
     {
         cons_blocks++;
     }
+    long cons_exp = -2 * (long)cons_blocks;
 
-    // Reduces the denominator to be between 0.5 and 1 then right shifts the Numerator by the same amount needed for reduce
-    struct bignum D_reduced;
-    int n = reduce(D, &D_reduced);
-    struct bignum N_reduced = rShift(N, n);
-
-    cutToSize(&D_reduced, cons_blocks * 2);
-    cutToSize(&N_reduced, cons_blocks * 2);
-
-    // magic0 is an aproximation for 48/17, magic1 for 32/17
-    struct bignum magic0;
-    magic0.length = D_reduced.subone + 1;
-    magic0.subone = magic0.length - 1;
+    // Stores the aproximation of the reciprocal
+    struct fixed x;
 
-    struct bignum magic1;
-    magic1.length = D_reduced.subone + 1;
-    magic1.subone = magic1.length - 1;
+    // Precision of the starting value in binary places
+    double start_prec;
 
-    magic0.numbers = calloc(magic0.length, sizeof(uint32_t));
-    magic1.numbers = calloc(magic1.length, sizeof(uint32_t));
-    if (magic0.numbers == NULL || magic1.numbers == NULL)
+    if (seed != NULL)
     {
-        fprintf(stderr, "Error while allocation memory!");
-        exit(EXIT_FAILURE);
+        x = fixedCopy(seed);
+        fixedTruncate(&x, cons_exp);
+        start_prec = seed_prec;
     }
-
-    // Fills the magic up to the same precision as D_reduced
-    for (size_t i = 0; i < magic0.length - 1; i++)
+    else
     {
-        magic0.numbers[i] = 0xd2d2d2d2;
-        magic1.numbers[i] = 0xe1e1e1e1;
+        // magic0 is an aproximation for 48/17, magic1 for 32/17, both as precise as d
+        size_t length = d->exp < 0 ? (size_t)-d->exp + 1 : 1;
+        struct fixed magic0 = fixedAlloc(length, 1 - (long)length);
+        struct fixed magic1 = fixedAlloc(length, 1 - (long)length);
+
+        for (size_t i = 0; i < length - 1; i++)
+        {
+            magic0.limbs[i] = 0xd2d2d2d2;
+            magic1.limbs[i] = 0xe1e1e1e1;
+        }
+        magic0.limbs[length - 1] = 0x2;
+        magic1.limbs[length - 1] = 0x1;
+
+        // Initial value for x wich is an aproximation of 48/17 - 32/17 * d
+        struct fixed temp = fixedMul(d, &magic1);
+        fixedTruncate(&temp, cons_exp);
+        x = fixedSub(&magic0, &temp);
+        fixedFree(&temp);
+        fixedFree(&magic0);
+        fixedFree(&magic1);
+        start_prec = log(17) / log(2);
     }
-    magic0.numbers[magic0.length - 1] = 0x2;
-    magic1.numbers[magic1.length - 1] = 0x1;
 
-    // Stores the aproximation of the reciprocal
-    struct bignum x;
+    // Required steps to achieve the required precision, every step doubles the precise places
+    int steps = ceil(log((prec + 1) / start_prec) / log(2));
 
-    // Initial value for x wich is an aproximation of 48/17 - 32/17 * D_reducedD_reduced
-    x = karazMult(&D_reduced, &magic1);
-    cutToSize(&x, cons_blocks * 2);
-    bignumFree(&magic1);
+    struct fixed two = fixedInt(2);
 
-    magic1 = bignumSub(&magic0, &x);
-    bignumFree(&x);
-    bignumFree(&magic0);
+    // x = x * (2 - x * d)
+    progressBegin(PHASE_DIVISION, steps > 0 ? steps : 0);
+    for (int i = 0; i < steps; i++)
+    {
+        progressStep(i);
+        struct fixed temp0 = fixedMul(d, &x);
+        fixedTruncate(&temp0, cons_exp);
+        struct fixed temp1 = fixedSub(&two, &temp0);
+        fixedFree(&temp0);
 
-    x = magic1;
+        temp0 = fixedMul(&x, &temp1);
+        fixedTruncate(&temp0, cons_exp);
 
-    // Required steps to achieve the required precision
-    int steps = ceil(log((prec + 1) / (log(17) / log(2))) / log(2));
+        fixedFree(&temp1);
+        fixedFree(&x);
 
-    struct bignum two;
-    bignumInit(&two, 2);
+        x = temp0;
+    }
+    fixedFree(&two);
 
-    // x = x * (2 - x * D_reducedD_reduced)
-    for (int i = 0; i < steps; i++)
+    return x;
+}
+
+/*
+ * Calculates the reciprocal of D_reduced (0.5 <= D_reduced < 1) with the precison of prec, see fixedReciprocal
+ */
+struct bignum newtonReciprocal(struct bignum *D_reduced, size_t prec, const struct bignum *seed, size_t seed_prec)
+{
+    struct fixed d = fixedView(D_reduced);
+    struct fixed x = fixedReciprocal(&d, prec, seed, seed_prec);
+    return fixedRelease(&x);
+}
+
+/*
+ * Calculates quotient N/D with the precison of prec using Newton-Raphson division
+ * The reciprocal of the reduced D starts from seed if given (see newtonReciprocal) and gets stored in recip if that is not NULL
+ */
+struct bignum newtonDivSeeded(struct bignum *N, struct bignum *D, size_t prec, const struct bignum *seed, size_t seed_prec, struct bignum *recip)
+{
+    // Number of considered blocks needed to assure the required precision
+    size_t cons_blocks = prec / 32;
+    if (prec % 32 != 0)
     {
-        struct bignum temp0 = karazMult(&D_reduced, &x);
-        cutToSize(&temp0, cons_blocks * 2);
-        struct bignum temp1 = bignumSub(&two, &temp0);
-        bignumFree(&temp0);
+        cons_blocks++;
+    }
 
-        temp0 = karazMult(&x, &temp1);
-        cutToSize(&temp0, cons_blocks * 2);
+    // Reduces the denominator to be between 0.5 and 1 then right shifts the Numerator by the same amount needed for reduce
+    struct bignum D_shifted;
+    int n = reduce(D, &D_shifted);
+    struct bignum N_shifted = rShift(N, n);
+    struct fixed D_reduced = fixedTake(&D_shifted);
+    struct fixed N_reduced = fixedTake(&N_shifted);
 
-        bignumFree(&temp1);
-        bignumFree(&x);
+    fixedTruncate(&D_reduced, -2 * (long)cons_blocks);
+    fixedTruncate(&N_reduced, -2 * (long)cons_blocks);
 
-        x = temp0;
-    }
-    bignumFree(&two);
+    struct fixed x = fixedReciprocal(&D_reduced, prec, seed, seed_prec);
 
     // The actual quotient is then computed with N * x
-    struct bignum quotient = karazMult(&N_reduced, &x);
-    cutToSize(&quotient, cons_blocks);
-    bignumFree(&x);
-    bignumFree(&D_reduced);
-    bignumFree(&N_reduced);
-    return quotient;
+    struct fixed quotient = fixedMul(&N_reduced, &x);
+    fixedTruncate(&quotient, -(long)cons_blocks);
+    // The division ends every run, with the terms, their reduced copies, the reciprocal and the quotient live at once
+    pagesSample();
+    if (recip != NULL)
+    {
+        *recip = fixedRelease(&x);
+    }
+    else
+    {
+        fixedFree(&x);
+    }
+    fixedFree(&D_reduced);
+    fixedFree(&N_reduced);
+    return fixedRelease(&quotient);
+}
+
+/*
+ * Calculates quotient N/D with the precison of prec using Newton-Raphson division
+ */
+struct bignum newtonDiv(struct bignum *N, struct bignum *D, size_t prec)
+{
+    return newtonDivSeeded(N, D, prec, NULL, 0, NULL);
 }
@@ -2,8 +2,10 @@
 #define OPERATIONS_H
 
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /*
  * Representation of big numbers used in computations, subone stores the amount of blocks used to represent subone places
@@ -15,9 +17,25 @@ struct bignum {
 	size_t subone;
 };
 
-void bignumPrintDec(const struct bignum *x, size_t totalDigits);
+struct bignum bignumPow(uint32_t base, size_t e);
 
-void binaryConverter(uint8_t *buffer, uint32_t *num, uint32_t *num2, int bufferIndex, int len);
+uint32_t *limbsAlloc(size_t count);
+
+uint32_t *limbsRealloc(uint32_t *limbs, size_t count);
+
+void limbsFree(uint32_t *limbs);
+
+uint32_t blocksMul1(uint32_t *r, const uint32_t *x, size_t n, uint32_t m);
+
+uint32_t blocksAddmul1(uint32_t *r, const uint32_t *x, size_t n, uint32_t m);
+
+uint32_t blocksDivrem1(uint32_t *r, const uint32_t *x, size_t n, uint32_t d);
+
+uint32_t blocksAdd(uint32_t *r, const uint32_t *x, const uint32_t *y, size_t n);
+
+void bignumPrintDec(FILE *stream, const struct bignum *x, size_t totalDigits);
+
+void bignumPrintDecWindow(FILE *stream, const struct bignum *x, size_t from, size_t count);
 
 void bignumInit(struct bignum *num, size_t n);
 
@@ -25,20 +43,62 @@ void bignumFree(struct bignum *num);
 
 void bignumPrint(const struct bignum *num);
 
-void printResultHex(const struct bignum *num, size_t prec);
+bool streamWrite64(FILE *stream, uint64_t value);
+
+bool streamRead64(FILE *stream, uint64_t *value);
+
+bool bignumWrite(FILE *stream, const struct bignum *num);
+
+bool bignumRead(FILE *stream, struct bignum *num);
+
+void printResultHex(FILE *stream, const struct bignum *num, size_t prec);
+
+void printHexWindow(FILE *stream, const struct bignum *num, size_t from, size_t count);
+
+void copy(struct bignum *x, struct bignum *y, int begin, int end);
 
 void cutToSize(struct bignum *num, size_t prec);
 
+void cutToBits(struct bignum *num, size_t prec);
+
 void bignumDec(struct bignum *x);
 
 struct bignum rShift(struct bignum *x, size_t n);
 
+void rShift32(struct bignum *x, size_t n);
+
 struct bignum bignumSub(struct bignum *x, struct bignum *y);
 
 struct bignum bignumAdd(struct bignum *x, struct bignum *y);
 
+int bignumCompare(const struct bignum *x, const struct bignum *y);
+
+uint32_t bignumResidue(const struct bignum *x);
+
+bool residueCheck(const struct bignum *x, const struct bignum *y, const struct bignum *product);
+
+struct bignum basecaseMult(const struct bignum *x, const struct bignum *y);
+
+void bignumAddAt(struct bignum *acc, size_t pos, const struct bignum *x);
+
+void bignumAddMult(struct bignum *acc, struct bignum *x, struct bignum *y);
+
+struct bignum unbalancedMult(const struct bignum *x, const struct bignum *y);
+
+struct bignum basecaseSqr(const struct bignum *x);
+
+struct bignum bignumSqr(struct bignum *x);
+
 struct bignum karazMult(struct bignum *x, struct bignum *y);
 
+size_t reduce(struct bignum *x, struct bignum *dest);
+
+size_t bignumBitLength(const struct bignum *x);
+
+struct bignum newtonReciprocal(struct bignum *D_reduced, size_t prec, const struct bignum *seed, size_t seed_prec);
+
+struct bignum newtonDivSeeded(struct bignum *N, struct bignum *D, size_t prec, const struct bignum *seed, size_t seed_prec, struct bignum *recip);
+
 struct bignum newtonDiv(struct bignum *x, struct bignum *y, size_t prec);
 
 struct bignum sqrt2(size_t n, size_t s);
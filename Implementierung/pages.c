@@ -0,0 +1,178 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "pages.h"
+#include "stats.h"
+
+static unsigned long online_nodes;
+static pthread_once_t nodes_once = PTHREAD_ONCE_INIT;
+static uint64_t live_mappings;
+
+/*
+ * Reads the mask of the online NUMA nodes, e.g. "0-1,3"; node 0 only if the kernel does not tell
+ */
+static void pagesReadNodes(void)
+{
+	online_nodes = 1;
+	FILE *file = fopen("/sys/devices/system/node/online", "r");
+	if (file == NULL) {
+		return;
+	}
+	unsigned long first, last;
+	unsigned long mask = 0;
+	while (fscanf(file, "%lu", &first) == 1) {
+		last = first;
+		int c = fgetc(file);
+		if (c == '-' && fscanf(file, "%lu", &last) == 1) {
+			c = fgetc(file);
+		}
+		for (unsigned long node = first; node <= last && node < 8 * sizeof(mask); node++) {
+			mask |= 1UL << node;
+		}
+		if (c != ',') {
+			break;
+		}
+	}
+	fclose(file);
+	if (mask != 0) {
+		online_nodes = mask;
+	}
+}
+
+/*
+ * Mappings are whole huge pages, so that the length of a mapping follows from the size of the allocation
+ */
+static size_t pagesLength(size_t bytes)
+{
+	return (bytes + PAGES_MIN - 1) & ~(PAGES_MIN - 1);
+}
+
+/*
+ * Asks for huge pages and sets the NUMA policy of the pages not touched yet; placement is only a hint, so failures are ignored,
+ * e.g. on kernels without NUMA support or in containers that forbid mbind
+ */
+static void pagesAdvise(char *start, size_t length, enum sqrt2_numa numa)
+{
+	madvise(start, length, MADV_HUGEPAGE);
+
+	unsigned long mask;
+	int mode;
+	if (numa == SQRT2_NUMA_INTERLEAVE) {
+		pthread_once(&nodes_once, pagesReadNodes);
+		mask = online_nodes;
+		mode = MPOL_INTERLEAVE;
+	} else if (numa == SQRT2_NUMA_LOCAL) {
+		unsigned int cpu, node;
+		if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= 8 * sizeof(mask)) {
+			return;
+		}
+		mask = 1UL << node;
+		mode = MPOL_BIND;
+	} else {
+		return;
+	}
+	syscall(SYS_mbind, start, length, mode, &mask, 8 * sizeof(mask), 0);
+}
+
+/*
+ * Maps bytes of zeroed memory aligned to a huge page, placed on the NUMA nodes numa asks for; NULL if the mapping fails
+ */
+void *pagesMap(size_t bytes, enum sqrt2_numa numa)
+{
+	size_t length = pagesLength(bytes);
+
+	// One huge page more than needed, so that the start can be moved to a huge page boundary
+	char *raw = mmap(NULL, length + PAGES_MIN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return NULL;
+	}
+	char *start = (char *)(((uintptr_t)raw + PAGES_MIN - 1) & ~(uintptr_t)(PAGES_MIN - 1));
+	if (start > raw) {
+		munmap(raw, start - raw);
+	}
+	munmap(start + length, raw + PAGES_MIN - start);
+
+	pagesAdvise(start, length, numa);
+	__atomic_fetch_add(&stats.mappings, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&live_mappings, 1, __ATOMIC_RELAXED);
+	return start;
+}
+
+/*
+ * Resizes a mapping of old_bytes to bytes; grows in place if the following address range is free, otherwise the content moves
+ * to a new mapping. Returns NULL and keeps the old mapping if there is not enough memory
+ */
+void *pagesRemap(void *ptr, size_t old_bytes, size_t bytes, enum sqrt2_numa numa)
+{
+	size_t old_length = pagesLength(old_bytes);
+	size_t length = pagesLength(bytes);
+	if (length <= old_length) {
+		if (length < old_length) {
+			munmap((char *)ptr + length, old_length - length);
+		}
+		return ptr;
+	}
+
+	if (mremap(ptr, old_length, length, 0) != MAP_FAILED) {
+		pagesAdvise((char *)ptr + old_length, length - old_length, numa);
+		return ptr;
+	}
+	void *moved = pagesMap(bytes, numa);
+	if (moved == NULL) {
+		return NULL;
+	}
+	memcpy(moved, ptr, old_bytes);
+	pagesUnmap(ptr, old_bytes);
+	return moved;
+}
+
+/*
+ * Unmaps memory of pagesMap
+ */
+void pagesUnmap(void *ptr, size_t bytes)
+{
+	__atomic_fetch_sub(&live_mappings, 1, __ATOMIC_RELAXED);
+	munmap(ptr, pagesLength(bytes));
+}
+
+/*
+ * Records how much of the process is backed by huge pages in the stats if it is more than recorded so far; reading it walks all
+ * mappings of the process, so it only gets sampled once per run, at the end of the division, and only if there are mappings
+ */
+void pagesSample(void)
+{
+	if (__atomic_load_n(&live_mappings, __ATOMIC_RELAXED) == 0) {
+		return;
+	}
+	uint64_t huge = pagesHugeBytes();
+	uint64_t peak = __atomic_load_n(&stats.huge_peak_bytes, __ATOMIC_RELAXED);
+	while (huge > peak && !__atomic_compare_exchange_n(&stats.huge_peak_bytes, &peak, huge, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+/*
+ * Returns the bytes of the process backed by transparent huge pages, 0 if the kernel does not report them
+ */
+uint64_t pagesHugeBytes(void)
+{
+	FILE *file = fopen("/proc/self/smaps_rollup", "r");
+	if (file == NULL) {
+		return 0;
+	}
+	char line[256];
+	unsigned long long kib = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (sscanf(line, "AnonHugePages: %llu kB", &kib) == 1) {
+			break;
+		}
+	}
+	fclose(file);
+	return (uint64_t)kib * 1024;
+}
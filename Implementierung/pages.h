@@ -0,0 +1,27 @@
+#ifndef PAGES_H
+#define PAGES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libsqrt2.h"
+
+// Size of a huge page on x86-64, mappings are made of whole ones
+#define PAGES_MIN ((size_t)2 << 20)
+
+// Allocations of at least this many bytes get their own mapping; half a huge page, so that the blocks of a million places, which stay
+// below a whole one, get huge pages too, while a mapping wastes at most as much as it uses
+#define PAGES_MAP_MIN (PAGES_MIN / 2)
+
+void *pagesMap(size_t bytes, enum sqrt2_numa numa);
+
+void *pagesRemap(void *ptr, size_t old_bytes, size_t bytes, enum sqrt2_numa numa);
+
+void pagesUnmap(void *ptr, size_t bytes);
+
+void pagesSample(void);
+
+uint64_t pagesHugeBytes(void);
+
+#endif
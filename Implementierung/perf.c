@@ -0,0 +1,132 @@
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf.h"
+
+const char *perf_names[PERF_EVENT_COUNT] = {"cycles", "instructions", "cache misses", "branch misses", "dTLB misses"};
+
+const uint32_t perf_types[PERF_EVENT_COUNT] = {
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HARDWARE,
+	PERF_TYPE_HW_CACHE,
+};
+
+// dTLB misses show whether the large blocks are backed by huge pages
+const uint64_t perf_configs[PERF_EVENT_COUNT] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+};
+
+/*
+ * Opens the hardware counters for the calling thread, user space only so that the default perf_event_paranoid setting allows it
+ * The counters are inherited, so they include the splitting threads and worker processes started while they are open
+ * Returns false if no counter is available at all, e.g. in containers or virtual machines without a PMU
+ */
+bool perfOpen(struct perf_counters *counters)
+{
+	bool any = false;
+
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = perf_types[i];
+		attr.config = perf_configs[i];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		counters->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		counters->value[i] = 0;
+		any = any || counters->fd[i] >= 0;
+	}
+	return any;
+}
+
+/*
+ * Sets all available counters back to zero, so that a measurement starts with the following perfStart
+ */
+void perfReset(struct perf_counters *counters)
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		counters->value[i] = 0;
+		if (counters->fd[i] >= 0) {
+			ioctl(counters->fd[i], PERF_EVENT_IOC_RESET, 0);
+		}
+	}
+}
+
+/*
+ * Starts all available counters, they keep counting on from where the last perfStop left them
+ */
+void perfStart(struct perf_counters *counters)
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (counters->fd[i] >= 0) {
+			ioctl(counters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+/*
+ * Stops all available counters and reads their values, the counts of every perfStart since the last perfReset together
+ */
+void perfStop(struct perf_counters *counters)
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		counters->value[i] = 0;
+		if (counters->fd[i] < 0) {
+			continue;
+		}
+		ioctl(counters->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		// value, time enabled, time running
+		uint64_t data[3];
+		if (read(counters->fd[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+			continue;
+		}
+		counters->value[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+	}
+}
+
+/*
+ * Prints the counts of the last measurement with the IPC and the counts per unit (e.g. per block and run)
+ */
+void perfPrint(FILE *stream, const struct perf_counters *counters, const char *label, double units)
+{
+	fprintf(stream, "Hardware counters (%s):\n", label);
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (counters->fd[i] < 0) {
+			fprintf(stream, "  %-14s %16s\n", perf_names[i], "unavailable");
+		} else {
+			fprintf(stream, "  %-14s %16" PRIu64 "  %12.3f per block\n", perf_names[i], counters->value[i], counters->value[i] / units);
+		}
+	}
+	if (counters->fd[PERF_CYCLES] >= 0 && counters->fd[PERF_INSTRUCTIONS] >= 0 && counters->value[PERF_CYCLES] != 0) {
+		fprintf(stream, "  %-14s %16.3f\n", "IPC", (double)counters->value[PERF_INSTRUCTIONS] / counters->value[PERF_CYCLES]);
+	}
+}
+
+/*
+ * Closes all available counters
+ */
+void perfClose(struct perf_counters *counters)
+{
+	for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (counters->fd[i] >= 0) {
+			close(counters->fd[i]);
+			counters->fd[i] = -1;
+		}
+	}
+}
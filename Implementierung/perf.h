@@ -0,0 +1,39 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum perf_event {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_EVENT_COUNT
+};
+
+/*
+ * Hardware counters of the calling thread and the threads and processes it starts; fd is -1 for every counter the kernel or the
+ * machine does not provide; value holds the counts of the last measurement, scaled up if the kernel had to multiplex the counters
+ */
+struct perf_counters {
+	int fd[PERF_EVENT_COUNT];
+	uint64_t value[PERF_EVENT_COUNT];
+};
+
+bool perfOpen(struct perf_counters *counters);
+
+void perfReset(struct perf_counters *counters);
+
+void perfStart(struct perf_counters *counters);
+
+void perfStop(struct perf_counters *counters);
+
+void perfPrint(FILE *stream, const struct perf_counters *counters, const char *label, double units);
+
+void perfClose(struct perf_counters *counters);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "plan.h"
+#include "engines.h"
+#include "context.h"
+#include "sqrt2.h"
+
+/*
+ * Upper bound for log2 of the tail of the series after summing the terms 1 to n - 1
+ * Term i is binomial(2i, i) / 8^i and every following term is less than half of its predecessor, so the tail is less than twice term n
+ */
+double tailLog2(size_t n)
+{
+	double term = (lgamma(2.0 * n + 1) - 2 * lgamma(n + 1.0)) / log(2) - 3.0 * n;
+	return term + 1;
+}
+
+/*
+ * Computes the plan for printing digits places in base 16 or 10; returns false if the working precision would exceed
+ * SQRT2_MAX_TERMS bits, the plan holds no precision then
+ * One guard block absorbs the error of the Newton division, the series gets summed until its tail is below the guard block as well
+ */
+bool planCompute(struct plan *plan, size_t digits, unsigned base)
+{
+	plan->digits = digits;
+	plan->base = base;
+	plan->engine = SQRT2_ENGINE_AUTO;
+	plan->threads = 1;
+	plan->memory = 0;
+	plan->fitted = false;
+	plan->reason[0] = '\0';
+
+	// The series needs about one term per bit, so the precision is bounded like the terms; checked before converting the places,
+	// so that neither the product nor the conversion of the rounded double overflows
+	double max_digits = (SQRT2_MAX_TERMS - 32.0) / (base == 16 ? 4 : log(base) / log(2));
+	if ((double)digits > max_digits) {
+		plan->bits = 0;
+		plan->guard_blocks = 0;
+		plan->prec = 0;
+		plan->terms = 0;
+		plan->tail_log2 = 0;
+		return false;
+	}
+
+	// Every hexadecimal place is exactly four bits, decimal places need log2(10) bits each
+	if (base == 16) {
+		plan->bits = digits * 4;
+	} else {
+		plan->bits = (size_t)ceil(digits * (log(base) / log(2)));
+	}
+
+	plan->guard_blocks = 1;
+	plan->prec = plan->bits + 32 * plan->guard_blocks;
+
+	// The tail bound is monotonically falling, so the smallest sufficient term count can be found by bisection
+	size_t lo = 2;
+	size_t hi = plan->prec + 2;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (tailLog2(mid) < -(double)plan->prec) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	plan->terms = lo;
+	plan->tail_log2 = tailLog2(lo);
+	return true;
+}
+
+/*
+ * Prints the given plan
+ */
+void planPrint(const struct plan *plan)
+{
+	printf("Plan for %zu %s places:\n", plan->digits, plan->base == 16 ? "hexadecimal" : "decimal");
+	printf("  required bits:      %zu\n", plan->bits);
+	printf("  guard blocks:       %zu (%zu bits)\n", plan->guard_blocks, 32 * plan->guard_blocks);
+	printf("  working precision:  %zu bits (%zu blocks)\n", plan->prec, (plan->prec + 31) / 32);
+	printf("  series terms:       %zu (T(1, %zu) / Q(1, %zu))\n", plan->terms - 1, plan->terms, plan->terms);
+	printf("  series tail:        < 2^%.1f\n", plan->tail_log2);
+	if (plan->engine != SQRT2_ENGINE_AUTO) {
+		printf("  engine:             %s with %zu threads (%s)\n", engineGet(plan->engine)->description, plan->threads, plan->reason);
+		printf("  memory:             about %.1f MiB\n", plan->memory / 1048576.0);
+	}
+}
+
+/*
+ * Returns the bytes of Q(1, n) for the n of the plan, the size the numbers of the exact splitting grow to: the factor of term k is
+ * 4k, so the product has about the sum of log2(4k) over k < n bits, n (log2(4n) - 1 / ln 2)
+ */
+double planSplitBytes(const struct plan *plan)
+{
+	double n = plan->terms;
+	return n * (log2(4 * n) - 1 / log(2)) / 8;
+}
+
+/*
+ * Returns the bytes of a number at the working precision of the plan, with the blocks bignums keep beyond it
+ */
+double planPrecBytes(const struct plan *plan)
+{
+	return (plan->prec / 32 + 2) * 4.0;
+}
+
+/*
+ * Estimates the most memory a run of the plan holds at once from the peaks make tune measures (see TUNING_MEMORY_SPLIT and the
+ * following in context.h): the exact splitting in multiples of the bytes of Q(1, n), the truncated splitting in multiples of the
+ * working precision growing with a power of the threads, as every thread keeps subtrees in progress, and the series in multiples
+ * of the working precision; the text of the places comes on top of all of them
+ */
+size_t planMemory(const struct plan *plan, enum sqrt2_engine engine, size_t threads)
+{
+	double bytes;
+	if (engine == SQRT2_ENGINE_SPLIT) {
+		bytes = planSplitBytes(plan) * TUNING_MEMORY_SPLIT / 100;
+	} else if (engine == SQRT2_ENGINE_TRUNCATED) {
+		bytes = planPrecBytes(plan) * TUNING_MEMORY_TRUNCATED / 100 * pow(threads, TUNING_MEMORY_THREADS / 100.0);
+	} else {
+		bytes = planPrecBytes(plan) * TUNING_MEMORY_SERIES / 100;
+	}
+	// Small runs are dominated by the allocations of the leaves and the Newton iterations on a few blocks
+	return (size_t)bytes + plan->digits + PLAN_MEMORY_BASE;
+}
+
+/*
+ * Estimates the most memory a saved run of the plan holds at once, the exact splitting together with the state it saves or
+ * extends: P, Q and T of all terms and the reciprocal of Q, in multiples of the bytes of Q(1, n) as well
+ */
+size_t planSavedMemory(const struct plan *plan)
+{
+	return (size_t)(planSplitBytes(plan) * TUNING_MEMORY_SAVED / 100) + plan->digits + PLAN_MEMORY_BASE;
+}
+
+/*
+ * Picks the settings for a run within max_bytes: the threads get halved and the exact splitting replaced by the truncated one
+ * until the estimate fits; returns false if even the cheapest settings exceed max_bytes, engine and threads hold them then
+ */
+bool planFit(const struct plan *plan, size_t max_bytes, enum sqrt2_engine *engine, size_t *threads)
+{
+	while (planMemory(plan, *engine, *threads) > max_bytes) {
+		if (*threads > 1) {
+			*threads /= 2;
+		} else if (*engine == SQRT2_ENGINE_SPLIT) {
+			*engine = SQRT2_ENGINE_TRUNCATED;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
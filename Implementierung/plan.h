@@ -0,0 +1,52 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libsqrt2.h"
+#include "stats.h"
+
+// Most places the sqrt2 program prints in one run
+#define PLAN_MAX_PLACES 1000000
+
+// Memory every run needs besides its numbers, the leaves and the Newton iterations on a few blocks
+#define PLAN_MEMORY_BASE 65536
+
+/*
+ * Precision plan for one run: how many bits and series terms are needed to print digits places in the given base
+ * bits is the precision the places themselves need, prec adds the guard blocks and is the s handed to the engines,
+ * terms is the n of T(1, n) / Q(1, n), so the series gets summed up to term n - 1
+ * engine, threads and memory are the settings sqrt2Plan picks for the run and the memory it needs with them, fitted is set if the
+ * memory budget of the context changed them; planCompute leaves them to the defaults of a context
+ */
+struct plan {
+	size_t digits;
+	unsigned base;
+	size_t bits;
+	size_t guard_blocks;
+	size_t prec;
+	size_t terms;
+	double tail_log2;
+	enum sqrt2_engine engine;
+	size_t threads;
+	size_t memory;
+	bool fitted;
+	char reason[STATS_REASON];
+};
+
+bool planCompute(struct plan *plan, size_t digits, unsigned base);
+
+void planPrint(const struct plan *plan);
+
+double planSplitBytes(const struct plan *plan);
+
+double planPrecBytes(const struct plan *plan);
+
+size_t planMemory(const struct plan *plan, enum sqrt2_engine engine, size_t threads);
+
+size_t planSavedMemory(const struct plan *plan);
+
+bool planFit(const struct plan *plan, size_t max_bytes, enum sqrt2_engine *engine, size_t *threads);
+
+#endif
@@ -0,0 +1,311 @@
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "progress.h"
+#include "context.h"
+
+// What the work of a phase gets counted in, the merge work of the splitting is only shown as fraction
+static const char *units[PHASE_COUNT] = {NULL, "iteration", "term", "place", NULL};
+
+// Progress the calling thread counts into outside of library calls, see progressUse
+static __thread struct progress *used_progress = NULL;
+
+static pthread_t reporter;
+static sem_t wake;
+static volatile sig_atomic_t dump_requested;
+static bool stopping;
+static double report_interval;
+static const char *status_path;
+static uint64_t run_start;
+static const struct progress *watched_progress;
+
+/*
+ * Initializes the progress of a context that has not started a phase yet
+ */
+void progressInit(struct progress *progress)
+{
+	memset(progress, 0, sizeof(*progress));
+	progress->cap = INFINITY;
+}
+
+/*
+ * Makes the calling thread count the phases it runs outside of library calls, like printing a result, into progress; NULL stops it
+ */
+void progressUse(struct progress *progress)
+{
+	used_progress = progress;
+}
+
+/*
+ * Returns the progress the calling thread counts into: the one of the context of the running library call, outside of library
+ * calls the one set by progressUse, NULL if there is none
+ */
+static struct progress *progressCurrent(void)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+	return ctx != NULL ? &ctx->progress : used_progress;
+}
+
+/*
+ * Starts counting the given phase with total units of work
+ */
+void progressBegin(enum stats_phase phase, uint64_t total)
+{
+	struct progress *progress = progressCurrent();
+	if (progress == NULL) {
+		return;
+	}
+	__atomic_store_n(&progress->done, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&progress->total, total, __ATOMIC_RELAXED);
+	__atomic_store_n(&progress->phase, phase, __ATOMIC_RELAXED);
+	__atomic_store_n(&progress->phase_start, statsNow(), __ATOMIC_RELEASE);
+}
+
+/*
+ * Sets the units of work of the running phase done so far
+ */
+void progressStep(uint64_t done)
+{
+	struct progress *progress = progressCurrent();
+	if (progress != NULL) {
+		__atomic_store_n(&progress->done, done, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Cost of one product of the halves of a node spanning terms: karazuba products of operands growing with the terms up to the cap
+ */
+static uint64_t mergeCost(const struct progress *progress, size_t terms)
+{
+	double length = terms < progress->cap ? terms : progress->cap;
+	return (uint64_t)pow(length, 1.585);
+}
+
+/*
+ * Returns the cost of all merges of the splitting tree over terms, one product each; every level has nodes of at most two
+ * neighbouring lengths, a and a + 1, so the tree gets summed up level by level
+ * With exact set the tree is the one of T(n1, n2), whose nodes of m terms compute the product trees of P and Q of their halves
+ * again, together the tree of m terms less its root, and make two products each
+ */
+static uint64_t treeCost(const struct progress *progress, size_t terms, bool exact)
+{
+	size_t a = terms;
+	uint64_t count_a = 1, count_b = 0;
+	uint64_t total = 0;
+	while (true) {
+		if (a > 1) {
+			total += count_a * (exact ? mergeCost(progress, a) + treeCost(progress, a, false) : mergeCost(progress, a));
+		}
+		total += count_b * (exact ? mergeCost(progress, a + 1) + treeCost(progress, a + 1, false) : mergeCost(progress, a + 1));
+		if (a <= 1) {
+			break;
+		}
+		// Both halves of a node have the length a / 2, or one of them has one term more
+		if (a % 2 == 0) {
+			count_a = 2 * count_a + count_b;
+		} else {
+			count_b = count_a + 2 * count_b;
+		}
+		a /= 2;
+	}
+	return total;
+}
+
+/*
+ * Starts counting the splitting of terms terms of a series of n terms by P, Q and T at once; keep caps the blocks of the merged
+ * nodes if it is not 0
+ * Every term adds about log2(4n) bits to Q, which gives the terms a node has when it reaches keep blocks
+ */
+void progressSplitBegin(size_t terms, size_t n, size_t keep)
+{
+	struct progress *progress = progressCurrent();
+	if (progress == NULL) {
+		return;
+	}
+	progress->cap = keep != 0 ? 32.0 * keep / log2(4.0 * n) : INFINITY;
+	progressBegin(PHASE_SPLIT, treeCost(progress, terms, false));
+}
+
+/*
+ * Starts counting the exact splitting of terms terms by T(1, n), followed by the product tree of Q(1, n)
+ */
+void progressExactBegin(size_t terms)
+{
+	struct progress *progress = progressCurrent();
+	if (progress == NULL) {
+		return;
+	}
+	progress->cap = INFINITY;
+	progressBegin(PHASE_SPLIT, treeCost(progress, terms, true) + treeCost(progress, terms, false));
+}
+
+/*
+ * Counts one product of the halves of a node spanning terms
+ */
+void progressMerge(size_t terms)
+{
+	struct progress *progress = progressCurrent();
+	if (progress != NULL) {
+		__atomic_fetch_add(&progress->done, mergeCost(progress, terms), __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Counts all merges of a subtree spanning terms at once, for subtrees computed elsewhere
+ */
+void progressTree(size_t terms)
+{
+	struct progress *progress = progressCurrent();
+	if (progress != NULL) {
+		__atomic_fetch_add(&progress->done, treeCost(progress, terms, false), __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Prints the running phase of progress, how far it got and an estimate of the time it still needs from its rate so far
+ */
+void progressPrint(FILE *stream, const struct progress *progress)
+{
+	uint64_t phase_start = __atomic_load_n(&progress->phase_start, __ATOMIC_ACQUIRE);
+	uint64_t now = statsNow();
+	if (phase_start == 0) {
+		fprintf(stream, "Progress: no phase started, %.1f s in total\n", (now - run_start) * 1e-9);
+		return;
+	}
+	enum stats_phase phase = __atomic_load_n(&progress->phase, __ATOMIC_RELAXED);
+	uint64_t done = __atomic_load_n(&progress->done, __ATOMIC_RELAXED);
+	uint64_t total = __atomic_load_n(&progress->total, __ATOMIC_RELAXED);
+	double in_phase = (now - phase_start) * 1e-9;
+	double fraction = total != 0 ? (double)(done < total ? done : total) / total : 0;
+
+	fprintf(stream, "Progress: %s", phase_names[phase]);
+	if (units[phase] != NULL) {
+		fprintf(stream, " %s %" PRIu64 " of %" PRIu64, units[phase], done, total);
+	}
+	fprintf(stream, " (%.1f%%), %.1f s in phase, %.1f s in total", 100 * fraction, in_phase, (now - run_start) * 1e-9);
+	if (fraction > 0 && fraction < 1) {
+		fprintf(stream, ", phase ends in about %.1f s", in_phase * (1 - fraction) / fraction);
+	}
+	fprintf(stream, "\n");
+}
+
+/*
+ * Writes a report to the status file, replacing the previous one at once so that readers never see half of it, or to stderr
+ * The final report only tells that the run is done
+ */
+static void progressWrite(bool final)
+{
+	FILE *file = stderr;
+	char temp[4096];
+	if (status_path != NULL) {
+		snprintf(temp, sizeof(temp), "%s.tmp", status_path);
+		file = fopen(temp, "w");
+		if (file == NULL) {
+			return;
+		}
+	}
+	if (final) {
+		fprintf(file, "Progress: done, %.1f s in total\n", (statsNow() - run_start) * 1e-9);
+	} else {
+		progressPrint(file, watched_progress);
+	}
+	if (file == stderr) {
+		return;
+	}
+	if (fclose(file) == 0) {
+		rename(temp, status_path);
+	}
+}
+
+static void progressSignal(int number)
+{
+	(void)number;
+	dump_requested = 1;
+	sem_post(&wake);
+}
+
+/*
+ * Reports every interval seconds, and with all counters of stats whenever SIGUSR1 arrives
+ */
+static void *progressReport(void *arg)
+{
+	(void)arg;
+	while (true) {
+		int waited;
+		if (report_interval > 0) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			double next = deadline.tv_nsec * 1e-9 + report_interval;
+			deadline.tv_sec += (time_t)next;
+			deadline.tv_nsec = (long)((next - floor(next)) * 1e9);
+			waited = sem_timedwait(&wake, &deadline);
+		} else {
+			waited = sem_wait(&wake);
+		}
+		if (waited != 0 && errno == EINTR) {
+			continue;
+		}
+		if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+			// The status file ends telling that the run is done
+			if (status_path != NULL) {
+				progressWrite(true);
+			}
+			return NULL;
+		}
+
+		if (dump_requested) {
+			dump_requested = 0;
+			progressPrint(stderr, watched_progress);
+			statsPrint(stderr, false);
+		} else if (waited != 0) {
+			progressWrite(false);
+		}
+	}
+}
+
+/*
+ * Starts reporting the progress watched every interval seconds to stderr, or to the file at path if it is not NULL, and on SIGUSR1;
+ * an interval of 0 only reports on SIGUSR1. Returns false if the reporting thread cannot be started
+ * watched has to stay valid until progressStop
+ */
+bool progressStart(const struct progress *watched, double interval, const char *path)
+{
+	watched_progress = watched;
+	report_interval = interval;
+	status_path = path;
+	run_start = statsNow();
+	stopping = false;
+	if (sem_init(&wake, 0, 0) != 0) {
+		return false;
+	}
+	if (pthread_create(&reporter, NULL, progressReport, NULL) != 0) {
+		sem_destroy(&wake);
+		return false;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = progressSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &action, NULL);
+	return true;
+}
+
+/*
+ * Stops reporting; the status file keeps the last report
+ */
+void progressStop(void)
+{
+	signal(SIGUSR1, SIG_IGN);
+	__atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+	sem_post(&wake);
+	pthread_join(reporter, NULL);
+	sem_destroy(&wake);
+}
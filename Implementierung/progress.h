@@ -0,0 +1,48 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+/*
+ * Progress of the running phase of one context: done of total units of work, the products of the splitting weighted by their
+ * cost, the iterations of the Newton division, the terms of the series or the places of the conversion; phase_start is 0 before
+ * the first phase
+ * The threads of a library call update it atomically, the reporting thread reads it while they do
+ */
+struct progress {
+	enum stats_phase phase;
+	uint64_t done;
+	uint64_t total;
+	uint64_t phase_start;
+	// Terms up to which the cost of a merge grows with its terms, the truncated splitting caps the operands at keep blocks
+	double cap;
+};
+
+void progressInit(struct progress *progress);
+
+void progressUse(struct progress *progress);
+
+void progressBegin(enum stats_phase phase, uint64_t total);
+
+void progressStep(uint64_t done);
+
+void progressSplitBegin(size_t terms, size_t n, size_t keep);
+
+void progressExactBegin(size_t terms);
+
+void progressMerge(size_t terms);
+
+void progressTree(size_t terms);
+
+void progressPrint(FILE *stream, const struct progress *progress);
+
+bool progressStart(const struct progress *watched, double interval, const char *path);
+
+void progressStop(void);
+
+#endif
@@ -0,0 +1,425 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "context.h"
+#include "sqrt2.h"
+#include "plan.h"
+
+/*
+ * Connection a request came from; refs counts the reader and all pending jobs, the last one to drop it closes the streams
+ */
+struct client {
+	FILE *in;
+	FILE *out;
+	pthread_mutex_t lock;
+	size_t refs;
+};
+
+/*
+ * Request that needs more precision than the server holds, queued for the worker threads
+ */
+struct job {
+	struct client *client;
+	unsigned base;
+	size_t digits;
+	struct timespec start;
+	struct job *next;
+};
+
+/*
+ * Shared state of the server: the job queue and the most precise result computed so far (best_prec is 0 if there is none)
+ */
+struct server {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct job *head;
+	struct job *tail;
+	bool stopping;
+	struct bignum best;
+	size_t best_prec;
+};
+
+/*
+ * Returns the seconds passed since start
+ */
+double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return end.tv_sec - start->tv_sec + 1e-9 * (end.tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Drops one reference to the client, closes its streams and frees it if it was the last one
+ */
+void clientRelease(struct client *client)
+{
+	pthread_mutex_lock(&client->lock);
+	bool last = --client->refs == 0;
+	pthread_mutex_unlock(&client->lock);
+
+	if (last) {
+		fclose(client->in);
+		if (client->out != stdout) {
+			fclose(client->out);
+		}
+		pthread_mutex_destroy(&client->lock);
+		free(client);
+	}
+}
+
+/*
+ * Copies the held result truncated to prec places into res if it is precise enough; returns false otherwise
+ */
+bool serverTake(struct server *server, size_t prec, struct bignum *res)
+{
+	pthread_mutex_lock(&server->lock);
+	bool hit = server->best_prec >= prec;
+	if (hit) {
+		copy(&server->best, res, 0, server->best.length - 1);
+		res->subone = server->best.subone;
+	}
+	pthread_mutex_unlock(&server->lock);
+
+	if (hit) {
+		cutToBits(res, prec);
+	}
+	return hit;
+}
+
+/*
+ * Writes the response line for one request: kind, places, where the result came from, latency in seconds and the places themselves
+ */
+void respond(struct client *client, unsigned base, size_t digits, const char *source, const struct timespec *start, const struct bignum *res)
+{
+	// The places get formatted first so that the latency includes the conversion
+	char *text = NULL;
+	size_t text_length = 0;
+	FILE *buffer = open_memstream(&text, &text_length);
+	if (buffer == NULL) {
+		fprintf(stderr, "Error while allocation memory!");
+		exit(EXIT_FAILURE);
+	}
+	if (base == 16) {
+		printResultHex(buffer, res, digits);
+	} else {
+		bignumPrintDec(buffer, res, digits);
+	}
+	fclose(buffer);
+
+	pthread_mutex_lock(&client->lock);
+	fprintf(client->out, "%s %zu %s %.6f %s", base == 16 ? "hex" : "dec", digits, source, elapsed(start), text);
+	fflush(client->out);
+	pthread_mutex_unlock(&client->lock);
+	free(text);
+}
+
+/*
+ * Writes an error line for a request that gets no places
+ */
+void respondError(struct client *client, const char *message)
+{
+	pthread_mutex_lock(&client->lock);
+	fprintf(client->out, "error %s\n", message);
+	fflush(client->out);
+	pthread_mutex_unlock(&client->lock);
+}
+
+/*
+ * Worker thread: computes queued requests and keeps the result if it is more precise than the one held
+ */
+void *serverWorker(void *arg)
+{
+	struct server *server = arg;
+
+	// Every worker computes with its own context, the held result is shared through the server
+	struct sqrt2_ctx *ctx;
+	if (sqrt2CtxCreate(&ctx, NULL) != SQRT2_OK) {
+		fprintf(stderr, "Error while allocation memory!");
+		exit(EXIT_FAILURE);
+	}
+
+	while (true) {
+		pthread_mutex_lock(&server->lock);
+		while (server->head == NULL && !server->stopping) {
+			pthread_cond_wait(&server->wake, &server->lock);
+		}
+		struct job *job = server->head;
+		if (job == NULL) {
+			pthread_mutex_unlock(&server->lock);
+			sqrt2CtxDestroy(ctx);
+			return NULL;
+		}
+		server->head = job->next;
+		if (server->head == NULL) {
+			server->tail = NULL;
+		}
+		pthread_mutex_unlock(&server->lock);
+
+		struct plan plan;
+		planCompute(&plan, job->digits, job->base);
+
+		// Another worker may have computed enough places while the job was queued
+		struct bignum res;
+		const char *source = "memory";
+		if (!serverTake(server, plan.prec, &res)) {
+			source = "computed";
+			int status = sqrt2Value(ctx, job->base, job->digits, &res);
+			if (status != SQRT2_OK) {
+				respondError(job->client, sqrt2Strerror(status));
+				clientRelease(job->client);
+				free(job);
+				continue;
+			}
+			// The context does not need to hold the result, the server does
+			sqrt2CtxClear(ctx);
+
+			pthread_mutex_lock(&server->lock);
+			if (plan.prec > server->best_prec) {
+				if (server->best_prec != 0) {
+					bignumFree(&server->best);
+				}
+				copy(&res, &server->best, 0, res.length - 1);
+				server->best.subone = res.subone;
+				server->best_prec = plan.prec;
+			}
+			pthread_mutex_unlock(&server->lock);
+		}
+
+		respond(job->client, job->base, job->digits, source, &job->start, &res);
+		bignumFree(&res);
+		clientRelease(job->client);
+		free(job);
+	}
+}
+
+/*
+ * Reads requests of the form "hex <places>" or "dec <places>" line by line from the client until it closes the connection
+ * Requests the held result covers are answered right away, all others are queued for the workers; requests for more places than
+ * the command line allows get an error line
+ */
+void serveClient(struct server *server, struct client *client)
+{
+	char line[256];
+
+	while (fgets(line, sizeof(line), client->in) != NULL) {
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		char kind[16];
+		size_t digits;
+		if (sscanf(line, "%15s %zu", kind, &digits) != 2 || (strcmp(kind, "hex") != 0 && strcmp(kind, "dec") != 0)) {
+			if (sscanf(line, "%15s", kind) == 1) {
+				respondError(client, "unknown request, expected \"hex <places>\" or \"dec <places>\"");
+			}
+			continue;
+		}
+		// The cap of the command line holds for every request, a single one could otherwise exhaust the memory of the server
+		if (strchr(line, '-') != NULL) {
+			respondError(client, "invalid number of places");
+			continue;
+		}
+		if (digits > PLAN_MAX_PLACES) {
+			respondError(client, "too many places, at most 1000000 per request");
+			continue;
+		}
+		unsigned base = strcmp(kind, "hex") == 0 ? 16 : 10;
+
+		struct plan plan;
+		planCompute(&plan, digits, base);
+
+		struct bignum res;
+		if (serverTake(server, plan.prec, &res)) {
+			respond(client, base, digits, "memory", &start, &res);
+			bignumFree(&res);
+			continue;
+		}
+
+		struct job *job = malloc(sizeof(struct job));
+		if (job == NULL) {
+			fprintf(stderr, "Error while allocation memory!");
+			exit(EXIT_FAILURE);
+		}
+		job->client = client;
+		job->base = base;
+		job->digits = digits;
+		job->start = start;
+		job->next = NULL;
+
+		pthread_mutex_lock(&client->lock);
+		client->refs++;
+		pthread_mutex_unlock(&client->lock);
+
+		pthread_mutex_lock(&server->lock);
+		if (server->tail != NULL) {
+			server->tail->next = job;
+		} else {
+			server->head = job;
+		}
+		server->tail = job;
+		pthread_cond_signal(&server->wake);
+		pthread_mutex_unlock(&server->lock);
+	}
+	clientRelease(client);
+}
+
+/*
+ * Creates a client for the given streams, holding the reference of its reader
+ */
+struct client *clientCreate(FILE *in, FILE *out)
+{
+	struct client *client = malloc(sizeof(struct client));
+	if (client == NULL) {
+		fprintf(stderr, "Error while allocation memory!");
+		exit(EXIT_FAILURE);
+	}
+	client->in = in;
+	client->out = out;
+	client->refs = 1;
+	pthread_mutex_init(&client->lock, NULL);
+	return client;
+}
+
+struct connection {
+	struct server *server;
+	int fd;
+};
+
+/*
+ * Reader thread of one socket connection
+ */
+void *serveConnection(void *arg)
+{
+	struct connection *connection = arg;
+	int out_fd = dup(connection->fd);
+	FILE *in = fdopen(connection->fd, "r");
+	FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+
+	if (in == NULL || out == NULL) {
+		if (in != NULL) {
+			fclose(in);
+		} else {
+			close(connection->fd);
+		}
+		if (out != NULL) {
+			fclose(out);
+		} else if (out_fd >= 0) {
+			close(out_fd);
+		}
+	} else {
+		serveClient(connection->server, clientCreate(in, out));
+	}
+	free(connection);
+	return NULL;
+}
+
+/*
+ * Accepts connections on a Unix socket at path forever, every connection gets its own reader thread
+ */
+int serveSocket(struct server *server, const char *path)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return EXIT_FAILURE;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path %s is too long!\n", path);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, path);
+	unlink(path);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+		perror(path);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr, "Serving requests on %s\n", path);
+
+	while (true) {
+		int client_fd = accept(fd, NULL, NULL);
+		if (client_fd < 0) {
+			continue;
+		}
+
+		struct connection *connection = malloc(sizeof(struct connection));
+		pthread_t thread;
+		if (connection == NULL) {
+			close(client_fd);
+			continue;
+		}
+		connection->server = server;
+		connection->fd = client_fd;
+		if (pthread_create(&thread, NULL, serveConnection, connection) != 0) {
+			close(client_fd);
+			free(connection);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+}
+
+/*
+ * Runs the request server with the given number of worker threads
+ * Reads requests from stdin until it is closed if socket_path is NULL, otherwise serves the Unix socket at socket_path
+ */
+int serverRun(const char *socket_path, size_t workers)
+{
+	struct server server;
+	pthread_mutex_init(&server.lock, NULL);
+	pthread_cond_init(&server.wake, NULL);
+	server.head = NULL;
+	server.tail = NULL;
+	server.stopping = false;
+	server.best_prec = 0;
+
+	pthread_t *threads = calloc(workers, sizeof(pthread_t));
+	if (threads == NULL) {
+		fprintf(stderr, "Error while allocation memory!");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t i = 0; i < workers; i++) {
+		if (pthread_create(&threads[i], NULL, serverWorker, &server) != 0) {
+			fprintf(stderr, "Could not start worker thread!\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	int status = EXIT_SUCCESS;
+	if (socket_path != NULL) {
+		status = serveSocket(&server, socket_path);
+	} else {
+		serveClient(&server, clientCreate(stdin, stdout));
+	}
+
+	// Lets the workers finish every queued job before they stop
+	pthread_mutex_lock(&server.lock);
+	server.stopping = true;
+	pthread_cond_broadcast(&server.wake);
+	pthread_mutex_unlock(&server.lock);
+	for (size_t i = 0; i < workers; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	if (server.best_prec != 0) {
+		bignumFree(&server.best);
+	}
+	pthread_cond_destroy(&server.wake);
+	pthread_mutex_destroy(&server.lock);
+	return status;
+}
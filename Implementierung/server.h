@@ -0,0 +1,8 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+int serverRun(const char *socket_path, size_t workers);
+
+#endif
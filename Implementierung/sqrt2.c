@@ -1,7 +1,21 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
 
+#include "context.h"
 #include "operations.h"
+#include "fixed.h"
+#include "distribute.h"
 #include "sqrt2.h"
+#include "stats.h"
+#include "progress.h"
+
+// Identifies files written by stateSave
+#define STATE_MAGIC "SQRT2PQT"
+// Precision in binary places below which reciprocalDoubling runs Newton from scratch
+#define DOUBLING_BASE 2048
 
 /*
  * Implementation of the polynomial p(n) = 2n - 1
@@ -41,6 +55,7 @@ struct bignum P(size_t n1, size_t n2)
 
 		bignumFree(&num0);
 		bignumFree(&num1);
+		progressMerge(n2 - n1);
 	}
 	return res;
 }
@@ -79,6 +94,7 @@ struct bignum Q(size_t n1, size_t n2)
 
 		bignumFree(&num0);
 		bignumFree(&num1);
+		progressMerge(n2 - n1);
 	}
 	return res;
 }
@@ -86,6 +102,8 @@ struct bignum Q(size_t n1, size_t n2)
 /*
  * Recursive definition of T(n1, n2); also similar to P(size_t n1, size_t n2), but more complex operations have to be performed
  * Every instance of a(n), b(n), A(n1, n2), B(n1, n2) have been omitted since they always evaluate to one
+ * The T of a half is computed before the P or Q it gets multiplied with, so that only a finished T is held while the cheaper
+ * recursion of P or Q runs instead of the other way round, and both operands get freed right after their product
  */
 struct bignum T(size_t n1, size_t n2)
 {
@@ -95,32 +113,44 @@ struct bignum T(size_t n1, size_t n2)
 	if (n1 == n2 - 1) {
 		res = p(n1);
 	} else {
-		struct bignum num0;
-		struct bignum num1;
-		struct bignum num2 = Q(nm, n2);
 		struct bignum num3 = T(n1, nm);
+		struct bignum num2 = Q(nm, n2);
 
-		num0 = karazMult(&num2, &num3);
+		res = karazMult(&num2, &num3);
 
 		bignumFree(&num2);
 		bignumFree(&num3);
+		progressMerge(n2 - n1);
 
-		num2 = P(n1, nm);
 		num3 = T(nm, n2);
+		num2 = P(n1, nm);
 
-		num1 = karazMult(&num2, &num3);
+		// Accumulates P(n1, nm) * T(nm, n2) into the first product instead of adding two separate products
+		bignumAddMult(&res, &num2, &num3);
 
 		bignumFree(&num2);
 		bignumFree(&num3);
-
-		res = bignumAdd(&num0, &num1);
-
-		bignumFree(&num0);
-		bignumFree(&num1);
+		progressMerge(n2 - n1);
 	}
 	return res;
 }
 
+/*
+ * Cuts the quotient T/Q down to s binary subone places and adds the leading one of sqrt2
+ */
+void finishResult(struct bignum *res, size_t s)
+{
+	// NewtonDiv already returns a result cut to the right amount of blocks, so only the unprecise places have to be cut here
+	s %= 32;
+	if (s != 0) {
+		res->numbers[0] = (res->numbers[0] >> (32 - s)) << (32 - s);
+	}
+
+	res->numbers = limbsRealloc(res->numbers, res->length + 1);
+	res->numbers[res->length] = 1;
+	res->length++;
+}
+
 /*
  * Returns the approximation of sqrt2 with precision of s binary subone places by computing 1 + T(1, n) / Q(1, n)
  */
@@ -133,71 +163,580 @@ struct bignum sqrt2(size_t n, size_t s)
 		return res;
 	}
 
+	uint64_t start = statsBegin(PHASE_SPLIT);
+	progressExactBegin(n - 1);
 	struct bignum N = T(1, n);
 	struct bignum D = Q(1, n);
+	statsPhase(PHASE_SPLIT, start);
 
+	start = statsBegin(PHASE_DIVISION);
 	res = newtonDiv(&N, &D, s);
+	statsPhase(PHASE_DIVISION, start);
 
 	bignumFree(&N);
 	bignumFree(&D);
 
-	// NewtonDiv already returns a result cut to the right amount of blocks, so only the unprecise places have to be cut here
-	s %= 32;
-	if (s != 0) {
-		res.numbers[0] = (res.numbers[0] >> (32 - s)) << (32 - s);
+	finishResult(&res, s);
+	return res;
+}
+
+/*
+ * Computes P(n1, n2), Q(n1, n2) and T(n1, n2) in one recursion
+ * If keep is not zero, every node whose Q exceeds keep blocks gets truncated: P, Q and T are shifted right by the same amount of blocks,
+ * which leaves the ratios T/Q and P/Q the recursion depends on unchanged up to one unit in the last kept place
+ * P is only computed if need_p is set, since the nodes along the right edge of the tree never use it
+ */
+struct pqt splitPQT(size_t n1, size_t n2, size_t keep, bool need_p)
+{
+	size_t nm = (n1 + n2) / 2;
+	struct pqt res;
+
+	if (n1 == n2 - 1) {
+		res.P = p(n1);
+		res.Q = q(n1);
+		res.T = p(n1);
+		res.err = 0;
+		return res;
+	}
+
+	struct pqt left = splitPQT(n1, nm, keep, true);
+	struct pqt right = splitPQT(nm, n2, keep, need_p);
+	res = pqtMerge(&left, &right, need_p);
+	pqtTrim(&res, keep);
+	progressMerge(n2 - n1);
+	return res;
+}
+
+/*
+ * Removes leading zero blocks of Q and truncates the node to keep blocks of Q if keep is not zero
+ */
+void pqtTrim(struct pqt *res, size_t keep)
+{
+	// karazMult may leave leading zero blocks, they must not count towards the kept precision
+	while (res->Q.length > 1 && res->Q.numbers[res->Q.length - 1] == 0) {
+		res->Q.length--;
+	}
+
+	if (keep != 0 && res->Q.length > keep) {
+		size_t drop = res->Q.length - keep;
+		rShift32(&res->P, drop);
+		rShift32(&res->Q, drop);
+		rShift32(&res->T, drop);
+		// Flooring T and Q moves T/Q by at most two units of the last kept block
+		res->err += 2;
+	}
+}
+
+/*
+ * Left subtree of splitParallel computed by another thread, with its own tracker for the allocations
+ */
+struct split_task {
+	size_t n1, n2, keep;
+	bool need_p;
+	size_t depth;
+	struct sqrt2_ctx *ctx;
+	struct tracker *call;
+	struct tracker tracker;
+	struct pqt res;
+};
+
+void *splitTask(void *arg)
+{
+	struct split_task *task = arg;
+
+	trackerBegin(&task->tracker, task->ctx);
+	// The thread counts towards the threads of the library call that started it
+	task->tracker.call = task->call;
+	if (setjmp(task->tracker.jump) != 0) {
+		trackerAbort(&task->tracker);
+		return NULL;
+	}
+	task->res = splitDepth(task->n1, task->n2, task->keep, task->need_p, task->depth);
+	// The allocations stay in the list of the task until the parent adopts them
+	trackerLeave(&task->tracker);
+	return NULL;
+}
+
+/*
+ * Same as splitPQT, but hands the left subtree of the upper depth levels to another thread each while the running library call has
+ * threads to spare, so that no more than its threads run at once
+ */
+struct pqt splitDepth(size_t n1, size_t n2, size_t keep, bool need_p, size_t depth)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+
+	if (depth == 0 || ctx == NULL || n2 - n1 < 2 * ctx->tuning.parallel_grain) {
+		return splitPQT(n1, n2, keep, need_p);
+	}
+
+	size_t nm = (n1 + n2) / 2;
+	struct split_task task = {.n1 = n1, .n2 = nm, .keep = keep, .need_p = true, .depth = depth - 1, .ctx = ctx,
+		.call = current_tracker->call};
+	pthread_t thread;
+	bool spawned = trackerTakeThread();
+	if (spawned && pthread_create(&thread, NULL, splitTask, &task) != 0) {
+		trackerReturnThread();
+		spawned = false;
+	}
+	if (!spawned) {
+		task.res = splitDepth(n1, nm, keep, true, depth - 1);
+	}
+
+	// The thread uses task, so a failure of the right subtree has to wait for it before leaving this function
+	struct tracker right_tracker;
+	trackerBegin(&right_tracker, ctx);
+	if (setjmp(right_tracker.jump) != 0) {
+		trackerAbort(&right_tracker);
+		if (spawned) {
+			pthread_join(thread, NULL);
+			trackerReturnThread();
+			trackerAdopt(current_tracker, &task.tracker);
+		}
+		contextFail(right_tracker.status, "Error: splitting failed!\n");
+	}
+	struct pqt right = splitDepth(nm, n2, keep, need_p, depth - 1);
+	trackerLeave(&right_tracker);
+	trackerAdopt(current_tracker, &right_tracker);
+
+	if (spawned) {
+		pthread_join(thread, NULL);
+		trackerReturnThread();
+		if (task.tracker.status != SQRT2_OK) {
+			contextFail(task.tracker.status, "Error: splitting thread failed!\n");
+		}
+		trackerAdopt(current_tracker, &task.tracker);
+	}
+
+	struct pqt res = pqtMerge(&task.res, &right, need_p);
+	pqtTrim(&res, keep);
+	progressMerge(n2 - n1);
+	return res;
+}
+
+/*
+ * Computes the node of the terms [n1, n2) like splitPQT, using up to the number of threads set in the context of the running library call
+ * and distributing the terms over worker processes if the context sets more than one
+ */
+struct pqt splitParallel(size_t n1, size_t n2, size_t keep, bool need_p)
+{
+	struct sqrt2_ctx *ctx = contextCurrent();
+	size_t depth = 0;
+
+	if (ctx != NULL && ctx->processes > 1 && n2 - n1 > 1) {
+		return distributeSplit(n1, n2, keep, need_p);
+	}
+	while (ctx != NULL && ((size_t)1 << depth) < current_tracker->call->threads) {
+		depth++;
+	}
+	return splitDepth(n1, n2, keep, need_p, depth);
+}
+
+/*
+ * Merges two neighbouring nodes into the node spanning both ranges; frees up both children
+ * P is only computed if need_p is set, the products get checked by their residues if the context of the running call asks for it
+ */
+struct pqt pqtMerge(struct pqt *left, struct pqt *right, bool need_p)
+{
+	struct pqt res;
+
+	// T = Q_r * T_l + P_l * T_r, the second product gets accumulated into the first
+	res.T = karazMult(&right->Q, &left->T);
+	bignumAddMult(&res.T, &left->P, &right->T);
+
+	res.Q = karazMult(&left->Q, &right->Q);
+	if (need_p) {
+		res.P = karazMult(&left->P, &right->P);
+	} else {
+		bignumInit(&res.P, 0);
+	}
+
+	struct sqrt2_ctx *ctx = contextCurrent();
+	if (ctx != NULL && ctx->verify) {
+		uint64_t t_residue = ((uint64_t)bignumResidue(&right->Q) * bignumResidue(&left->T) % 0xffffffff
+			+ (uint64_t)bignumResidue(&left->P) * bignumResidue(&right->T) % 0xffffffff) % 0xffffffff;
+		if (t_residue != bignumResidue(&res.T) || !residueCheck(&left->Q, &right->Q, &res.Q) || (need_p && !residueCheck(&left->P, &right->P, &res.P))) {
+			contextFail(SQRT2_EVERIFY, "DEBUG: residue check of a merge failed!\n");
+		}
+	}
+
+	/*
+	 * T/Q = T_l/Q_l + P_l/Q_l * T_r/Q_r with P_l/Q_l < 1/2 and T_r/Q_r < 1,
+	 * so the error of the left child counts at most twice and the one of the right child once
+	 */
+	res.err = 2 * left->err + right->err;
+
+	pqtFree(left);
+	pqtFree(right);
+	return res;
+}
+
+/*
+ * Frees up all bignums of the given node
+ */
+void pqtFree(struct pqt *node)
+{
+	bignumFree(&node->P);
+	bignumFree(&node->Q);
+	bignumFree(&node->T);
+}
+
+/*
+ * Same as sqrt2(size_t n, size_t s), but truncates P, Q and T at the upper levels of the splitting to the precision needed for s places
+ * The guard blocks cover the worst case error growth of three units per tree level, the tracked bound gets checked against it at the end
+ */
+struct bignum sqrt2_truncated(size_t n, size_t s)
+{
+	struct bignum res;
+
+	if (s == 0) {
+		bignumInit(&res, 1);
+		return res;
+	}
+
+	size_t depth = 0;
+	while (((size_t)1 << depth) < n) {
+		depth++;
+	}
+
+	// The error bound is at most 3^(depth + 1) units, log2(3) < 1.59
+	size_t guard_bits = (159 * (depth + 1) + 99) / 100 + 1;
+	size_t s_blocks = (s + 31) / 32;
+	size_t guard_blocks = (guard_bits + 31) / 32;
+
+	// One additional block since a number with keep blocks may only have a leading block of one
+	size_t keep = s_blocks + guard_blocks + 1;
+
+	uint64_t start = statsBegin(PHASE_SPLIT);
+	progressSplitBegin(n - 1, n, keep);
+	struct pqt root = splitParallel(1, n, keep, false);
+	statsPhase(PHASE_SPLIT, start);
+
+	// The error is err units of 2^(-32 * (keep - 1)); it has to stay below 2^(-s - 1)
+	if (root.err * 2 >= ldexp(1.0, 32 * (keep - 1) - s)) {
+		contextFail(SQRT2_EPRECISION, "Error: truncation error exceeds the guard blocks!\n");
 	}
 
-	res.numbers = realloc(res.numbers, (res.length + 1) * sizeof(uint32_t));
-	res.numbers[res.length] = 1;
-	res.length++;
+	start = statsBegin(PHASE_DIVISION);
+	res = newtonDiv(&root.T, &root.Q, s);
+	statsPhase(PHASE_DIVISION, start);
+	pqtFree(&root);
 
+	finishResult(&res, s);
 	return res;
 }
 
 /*
- * Computes sqrt2 without binary Splitting
+ * Compares y^2 with 2 into order (negative, 0 or positive); returns false if the squaring fails its residue check
+ */
+static bool squareCompare(const struct bignum *y, int *order)
+{
+	struct bignum square = karazMult((struct bignum *)y, (struct bignum *)y);
+	bool checked = residueCheck(y, y, &square);
+	struct bignum two;
+	bignumInit(&two, 2);
+	*order = bignumCompare(&square, &two);
+	bignumFree(&two);
+	bignumFree(&square);
+	return checked;
+}
+
+/*
+ * Checks that x approximates sqrt2 to prec binary places: with y being x truncated to prec places, the value the printed places come
+ * from, and u = 2^(-prec), y^2 <= 2 < (y + u)^2 has to hold exactly, so that y is sqrt2 rounded down to prec places
+ * Both squarings get checked by their residues
+ */
+bool sqrt2Verify(const struct bignum *x, size_t prec)
+{
+	progressBegin(PHASE_VERIFY, 0);
+	struct bignum low;
+	copy((struct bignum *)x, &low, 0, x->length - 1);
+	low.subone = x->subone;
+	cutToBits(&low, prec);
+
+	struct bignum unit;
+	unit.subone = (prec + 31) / 32;
+	unit.length = unit.subone > 0 ? unit.subone : 1;
+	unit.numbers = limbsAlloc(unit.length);
+	memset(unit.numbers, 0, unit.length * sizeof(uint32_t));
+	unit.numbers[0] = (uint32_t)1 << (32 * unit.subone - prec);
+	struct bignum high = bignumAdd(&low, &unit);
+
+	int low_order, high_order;
+	bool verified = squareCompare(&low, &low_order) && squareCompare(&high, &high_order) && low_order <= 0 && high_order > 0;
+
+	bignumFree(&high);
+	bignumFree(&unit);
+	bignumFree(&low);
+	return verified;
+}
+
+/*
+ * Initializes an empty state, the first sqrt2_extend on it computes from scratch
+ */
+void stateInit(struct sqrt2_state *state)
+{
+	state->n = 0;
+	state->prec = 0;
+}
+
+/*
+ * Frees up all allocated memory of the given state
+ */
+void stateFree(struct sqrt2_state *state)
+{
+	if (state->n != 0) {
+		pqtFree(&state->node);
+		bignumFree(&state->recip);
+	}
+	state->n = 0;
+}
+
+/*
+ * Writes the state to the file at path: a magic, n and prec followed by P, Q, T and the reciprocal in binary limb format
+ * Returns false if the file cannot be written
+ */
+bool stateSave(const struct sqrt2_state *state, const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+
+	uint64_t header[2] = {state->n, state->prec};
+	bool ok = fwrite(STATE_MAGIC, 1, 8, file) == 8 && fwrite(header, sizeof(uint64_t), 2, file) == 2
+		&& bignumWrite(file, &state->node.P) && bignumWrite(file, &state->node.Q)
+		&& bignumWrite(file, &state->node.T) && bignumWrite(file, &state->recip);
+
+	return fclose(file) == 0 && ok;
+}
+
+/*
+ * Reads a state written by stateSave from the file at path into the empty state
+ * Returns false if the file cannot be read or is no state file, state stays empty in that case
+ */
+bool stateLoad(struct sqrt2_state *state, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+
+	char magic[8];
+	uint64_t header[2];
+	bool ok = fread(magic, 1, 8, file) == 8 && memcmp(magic, STATE_MAGIC, 8) == 0
+		&& fread(header, sizeof(uint64_t), 2, file) == 2 && header[0] > 1;
+
+	// Every bignum read successfully has to be freed again if a later one fails
+	struct bignum *parts[4] = {&state->node.P, &state->node.Q, &state->node.T, &state->recip};
+	size_t read = 0;
+	while (ok && read < 4) {
+		ok = bignumRead(file, parts[read]);
+		if (ok) {
+			read++;
+		}
+	}
+	fclose(file);
+
+	if (!ok) {
+		for (size_t i = 0; i < read; i++) {
+			bignumFree(parts[i]);
+		}
+		return false;
+	}
+
+	state->n = header[0];
+	state->prec = header[1];
+	state->node.err = 0;
+	return true;
+}
+
+/*
+ * Computes the reciprocal of the reduced d (0.5 <= d < 1) to prec binary places from the one to half the places, so that only the
+ * last doubling step runs at full precision instead of every Newton step; each level considers only the blocks of d it needs
+ */
+static struct bignum reciprocalDoubling(const struct bignum *d, size_t prec)
+{
+	struct bignum cut;
+	copy((struct bignum *)d, &cut, 0, d->length - 1);
+	cut.subone = d->subone;
+	cutToSize(&cut, 2 * ((prec + 31) / 32));
+
+	struct bignum res;
+	if (prec <= DOUBLING_BASE) {
+		res = newtonReciprocal(&cut, prec, NULL, 0);
+	} else {
+		// The guard places keep the seed precise to more than half of prec after the truncations of its own steps
+		size_t half = prec / 2 + 32;
+		struct bignum seed = reciprocalDoubling(&cut, half);
+		res = newtonReciprocal(&cut, prec, &seed, half - 2);
+		bignumFree(&seed);
+	}
+	bignumFree(&cut);
+	return res;
+}
+
+/*
+ * Computes sqrt2 with precision of s binary subone places from the terms [1, n), reusing and updating the given state
+ * Only the terms [state->n, n) get computed and merged into the stored node, the reciprocal of the new Q starts from the product
+ * of the stored reciprocal and the one of the new range to half of s places, so the Newton division only does the last doubling step
+ * as long as the stored reciprocal holds at least half of s places
+ */
+struct bignum sqrt2_extend(struct sqrt2_state *state, size_t n, size_t s)
+{
+	struct bignum res;
+
+	if (s == 0) {
+		bignumInit(&res, 1);
+		return res;
+	}
+
+	struct bignum seed;
+	size_t seed_prec = 0;
+	bool grown = state->n == 0 || n > state->n;
+	uint64_t start = statsBegin(PHASE_SPLIT);
+
+	if (grown) {
+		progressSplitBegin(n - (state->n != 0 ? state->n : 1), n, 0);
+	}
+	if (state->n == 0) {
+		state->node = splitParallel(1, n, 0, true);
+		state->n = n;
+	} else if (n > state->n) {
+		struct pqt right = splitParallel(state->n, n, 0, true);
+
+		// The seed of 1/Q only has to be precise to half of s for the division to do a single doubling step, and cannot be more
+		// precise than the stored reciprocal; the one of the new range gets doubled up to that from a coarse one
+		size_t r_prec = s / 2 + 32;
+		if (r_prec > state->prec) {
+			r_prec = state->prec;
+		}
+		struct bignum right_reduced;
+		size_t e_right = reduce(&right.Q, &right_reduced);
+		struct bignum recip_right = reciprocalDoubling(&right_reduced, r_prec);
+		bignumFree(&right_reduced);
+		cutToSize(&state->recip, (r_prec + 31) / 32);
+
+		size_t e_left = bignumBitLength(&state->node.Q);
+		state->node = pqtMerge(&state->node, &right, true);
+		state->n = n;
+
+		// 1/Q = 1/Q_l * 1/Q_r; the reduced Q is half of the product of the reduced factors if it has one bit less than both together
+		seed = karazMult(&state->recip, &recip_right);
+		bignumFree(&recip_right);
+		bignumFree(&state->recip);
+		if (bignumBitLength(&state->node.Q) < e_left + e_right) {
+			struct bignum half;
+			bignumInit(&half, 0x80000000);
+			half.subone = 1;
+			struct bignum temp = karazMult(&seed, &half);
+			bignumFree(&seed);
+			bignumFree(&half);
+			seed = temp;
+		}
+
+		// The errors of both factors add up
+		seed_prec = r_prec > 2 ? r_prec - 2 : 1;
+	} else {
+		// Enough terms are stored already, the reciprocal only has to be refined if more places are requested
+		seed = state->recip;
+		seed_prec = state->prec;
+	}
+
+	statsPhase(PHASE_SPLIT, start);
+
+	start = statsBegin(PHASE_DIVISION);
+	struct bignum recip;
+	res = newtonDivSeeded(&state->node.T, &state->node.Q, s, seed_prec != 0 ? &seed : NULL, seed_prec, &recip);
+	statsPhase(PHASE_DIVISION, start);
+
+	if (grown) {
+		if (seed_prec != 0) {
+			bignumFree(&seed);
+		}
+		state->recip = recip;
+		state->prec = s;
+	} else if (s > state->prec) {
+		bignumFree(&state->recip);
+		state->recip = recip;
+		state->prec = s;
+	} else {
+		bignumFree(&recip);
+	}
+
+	finishResult(&res, s);
+	return res;
+}
+
+/*
+ * Computes sqrt2 without binary Splitting by summing the terms 1 to n of the series on a fixed point accumulator
+ * Every term follows from its predecessor as term_i = term_(i-1) * (2i - 1) / 4i, so each one costs a single block multiplication and division
  */
 struct bignum sqrt2_V1(size_t n, size_t s)
 {
+	struct bignum res;
+
 	if (s == 0) {
-		struct bignum res;
 		bignumInit(&res, 1);
 		return res;
 	}
+	if (n >= SQRT2_SERIES_MAX_TERMS) {
+		contextFail(SQRT2_EINVAL, "Error: the series cannot sum this many terms, use a splitting engine!\n");
+	}
+
+	size_t cons_blocks = (s + 31) / 32;
 
-	size_t cons_blocks = s / 32;
-	if (s % 32 != 0) {
-		cons_blocks++;
+	// Every division rounds the term down by less than one unit, the error of a term stays below two units since the terms halve,
+	// so the guard blocks have to hold 2n units
+	size_t guard_bits = 2;
+	while (((size_t)1 << (guard_bits - 2)) < n) {
+		guard_bits++;
 	}
+	size_t guard_blocks = (guard_bits + 31) / 32;
+	size_t len = cons_blocks + guard_blocks;
+
+	// Both numbers have len subone blocks and one block before the comma
+	uint32_t *term = limbsAlloc(len + 1);
+	struct fixed total = fixedAlloc(len + 1, -(long)len);
+	uint32_t *sum = total.limbs;
+	term[len] = 1;
+	// Blocks of the term from top upwards are zero, the falling terms need fewer and fewer blocks
+	size_t top = len + 1;
 
-	struct bignum temp0;
-	struct bignum temp1;
-	struct bignum temp2;
-	bignumInit(&temp2, 0);
+	uint64_t start = statsBegin(PHASE_SERIES);
 
+	progressBegin(PHASE_SERIES, n);
 	for (size_t i = 1; i <= n; i++) {
-		bignumInit(&temp1, 1);
-		for (size_t k = 1; k <= i; k++) {
-			struct bignum N = p(k);
-			struct bignum D = q(k);
-
-			temp0 = newtonDiv(&N, &D, s);
-			bignumFree(&N);
-			N = karazMult(&temp0, &temp1);
-			// Cutting to desired precision + 1 block for potential carry
-			cutToSize(&N, cons_blocks + 1);
-			bignumFree(&temp1);
-			bignumFree(&temp0);
-			temp1 = N;
-			bignumFree(&D);
-		}	
-		temp0 = bignumAdd(&temp1, &temp2);
-		bignumFree(&temp1);
-		bignumFree(&temp2);
-		temp2 = temp0;
-		cutToSize(&temp2, cons_blocks);
-	}
-
-	temp2.numbers[temp2.length - 1] = 1;
-	return temp2;
+		if (i % 1024 == 0) {
+			progressStep(i);
+		}
+		// term * (2i - 1) < 2i, so the carry fits into the block before the comma at the latest
+		uint32_t carry = blocksMul1(term, term, top, (uint32_t)(2 * i - 1));
+		if (carry != 0) {
+			term[top++] = carry;
+		}
+		blocksDivrem1(term, term, top, (uint32_t)(4 * i));
+		while (top > 0 && term[top - 1] == 0) {
+			top--;
+		}
+		if (top == 0) {
+			break;
+		}
+
+		carry = blocksAdd(sum, sum, term, top);
+		for (size_t k = top; carry != 0 && k <= len; k++) {
+			sum[k]++;
+			carry = sum[k] == 0;
+		}
+	}
+
+	statsPhase(PHASE_SERIES, start);
+	limbsFree(term);
+
+	// The sum stays below one, dropping the guard blocks leaves cons_blocks subone blocks
+	total.length = len;
+	fixedTruncate(&total, -(long)cons_blocks);
+	res = fixedRelease(&total);
+
+	finishResult(&res, s);
+	return res;
 }
@@ -1,11 +1,67 @@
 #ifndef SQRT2_H
 #define SQRT2_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include "operations.h"
+
+// Most terms of the series a run or a job of a worker may cover; the nodes of this many terms already take terabytes
+#define SQRT2_MAX_TERMS ((size_t)1 << 40)
+// Most terms the series sums, the divisor 4n of its terms has to fit into one block
+#define SQRT2_SERIES_MAX_TERMS ((size_t)1 << 30)
+
+/*
+ * P(n1, n2), Q(n1, n2) and T(n1, n2) of one node of the binary splitting tree
+ * err bounds the error of T/Q and P/Q introduced by truncation, in units of the last block kept of Q
+ */
+struct pqt {
+	struct bignum P;
+	struct bignum Q;
+	struct bignum T;
+	double err;
+};
+
+/*
+ * State of a finished run that can be extended to more terms without recomputing the ones already covered:
+ * the exact node of the terms [1, n) and the reciprocal of its reduced Q with prec binary places
+ */
+struct sqrt2_state {
+	size_t n;
+	size_t prec;
+	struct pqt node;
+	struct bignum recip;
+};
+
+struct pqt splitPQT(size_t n1, size_t n2, size_t keep, bool need_p);
+
+void pqtTrim(struct pqt *res, size_t keep);
+
+struct pqt splitDepth(size_t n1, size_t n2, size_t keep, bool need_p, size_t depth);
+
+struct pqt splitParallel(size_t n1, size_t n2, size_t keep, bool need_p);
+
+struct pqt pqtMerge(struct pqt *left, struct pqt *right, bool need_p);
+
+void pqtFree(struct pqt *node);
+
+bool sqrt2Verify(const struct bignum *x, size_t prec);
+
+void stateInit(struct sqrt2_state *state);
+
+void stateFree(struct sqrt2_state *state);
+
+bool stateSave(const struct sqrt2_state *state, const char *path);
+
+bool stateLoad(struct sqrt2_state *state, const char *path);
+
+struct bignum sqrt2_extend(struct sqrt2_state *state, size_t n, size_t s);
+
 struct bignum sqrt2(size_t n, size_t s);
 
+struct bignum sqrt2_truncated(size_t n, size_t s);
+
 struct bignum sqrt2_V1(size_t n, size_t s);
 
 
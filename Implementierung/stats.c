@@ -0,0 +1,275 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+struct stats stats;
+
+/*
+ * Counters of the calling thread that change with every operation and allocation; statsMerge adds them to stats at the end of every
+ * library call and phase, so that the threads of a computation do not contend for the shared counters
+ */
+struct stats_local {
+	uint64_t calls[OP_COUNT];
+	uint64_t histogram[OP_COUNT][STATS_BUCKETS];
+	uint64_t products;
+	uint64_t allocations;
+	uint64_t allocated_bytes;
+	bool counted;
+};
+
+static __thread struct stats_local local;
+
+// Counters the calling thread counts into instead of stats, see statsRedirect
+static __thread struct stats *sink = NULL;
+
+// Guards the engine and its reason, which are written by every computation and cannot be updated atomically
+static pthread_mutex_t engine_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char *phase_names[PHASE_COUNT] = {"split", "division", "series", "output", "verify"};
+const char *op_names[OP_COUNT] = {"karazMult", "bignumAdd", "bignumSub"};
+
+/*
+ * Returns the monotonic time in nanoseconds
+ */
+uint64_t statsNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Returns the counters the calling thread counts into
+ */
+static struct stats *statsTarget(void)
+{
+	return sink != NULL ? sink : &stats;
+}
+
+/*
+ * Marks the given phase as running, so that the counters printed meanwhile include the time it has run so far; returns its start,
+ * the start value of statsPhase
+ */
+uint64_t statsBegin(enum stats_phase phase)
+{
+	uint64_t start = statsNow();
+	__atomic_store_n(&statsTarget()->running_since[phase], start, __ATOMIC_RELAXED);
+	return start;
+}
+
+/*
+ * Adds the time since start to the given phase and ends it
+ */
+void statsPhase(enum stats_phase phase, uint64_t start)
+{
+	struct stats *target = statsTarget();
+	__atomic_fetch_add(&target->phase_ns[phase], statsNow() - start, __ATOMIC_RELAXED);
+	__atomic_store_n(&target->running_since[phase], 0, __ATOMIC_RELAXED);
+	statsMerge();
+}
+
+/*
+ * Returns the time spent in the phase in nanoseconds, with the time the phase has run so far if it is still running at now
+ */
+static uint64_t phaseTime(enum stats_phase phase, uint64_t now, bool *running)
+{
+	uint64_t since = __atomic_load_n(&stats.running_since[phase], __ATOMIC_RELAXED);
+	*running = since != 0 && since < now;
+	return __atomic_load_n(&stats.phase_ns[phase], __ATOMIC_RELAXED) + (*running ? now - since : 0);
+}
+
+/*
+ * Counts one call of the given operation with the longer operand having length blocks
+ */
+void statsOp(enum stats_op op, size_t length)
+{
+	size_t bucket = 0;
+	while (length > 1 && bucket < STATS_BUCKETS - 1) {
+		length >>= 1;
+		bucket++;
+	}
+	local.calls[op]++;
+	local.histogram[op][bucket]++;
+	local.counted = true;
+}
+
+/*
+ * Counts count block products of a base case multiplication
+ */
+void statsProducts(uint64_t count)
+{
+	local.products += count;
+	local.counted = true;
+}
+
+/*
+ * Records the engine the computation runs on and why it was chosen
+ */
+void statsEngine(const char *name, const char *reason)
+{
+	struct stats *target = statsTarget();
+	pthread_mutex_lock(&engine_lock);
+	target->engine = name;
+	snprintf(target->engine_reason, sizeof(target->engine_reason), "%s", reason);
+	pthread_mutex_unlock(&engine_lock);
+}
+
+/*
+ * Accounts an allocation of bytes of blocks and updates the peak of the live memory
+ * The live memory stays shared, blocks are often freed by another thread than the one that allocated them
+ */
+void statsAlloc(size_t bytes)
+{
+	local.allocations++;
+	local.allocated_bytes += bytes;
+	local.counted = true;
+	struct stats *target = statsTarget();
+	uint64_t live = __atomic_add_fetch(&target->live_bytes, bytes, __ATOMIC_RELAXED);
+
+	uint64_t peak = __atomic_load_n(&target->peak_bytes, __ATOMIC_RELAXED);
+	while (live > peak && !__atomic_compare_exchange_n(&target->peak_bytes, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+/*
+ * Accounts freeing bytes of blocks
+ */
+void statsFree(size_t bytes)
+{
+	__atomic_fetch_sub(&statsTarget()->live_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Adds the counters the calling thread collected since its last merge to stats, or to the sink it counts into
+ */
+void statsMerge(void)
+{
+	if (!local.counted) {
+		return;
+	}
+	struct stats *target = statsTarget();
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		__atomic_fetch_add(&target->calls[i], local.calls[i], __ATOMIC_RELAXED);
+		for (size_t b = 0; b < STATS_BUCKETS; b++) {
+			if (local.histogram[i][b] != 0) {
+				__atomic_fetch_add(&target->histogram[i][b], local.histogram[i][b], __ATOMIC_RELAXED);
+			}
+		}
+	}
+	__atomic_fetch_add(&target->products, local.products, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&target->allocations, local.allocations, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&target->allocated_bytes, local.allocated_bytes, __ATOMIC_RELAXED);
+	memset(&local, 0, sizeof(local));
+}
+
+/*
+ * Resets every counter except the live memory, which still belongs to the blocks allocated before
+ */
+void statsReset(void)
+{
+	pthread_mutex_lock(&engine_lock);
+	uint64_t live = stats.live_bytes;
+	memset(&stats, 0, sizeof(stats));
+	stats.live_bytes = live;
+	stats.peak_bytes = live;
+	pthread_mutex_unlock(&engine_lock);
+}
+
+/*
+ * Returns the peak resident set size of the process in bytes, 0 if the system does not report it
+ */
+uint64_t statsPeakRss(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+	// Linux reports kilobytes
+	return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+/*
+ * Prints the counters as table or as JSON object; those of computations still running on other threads count up to their last phase,
+ * the time of running phases up to now
+ */
+void statsPrint(FILE *stream, bool json)
+{
+	statsMerge();
+	uint64_t now = statsNow();
+	bool running;
+
+	// A computation running on another thread may set the engine meanwhile
+	pthread_mutex_lock(&engine_lock);
+	const char *engine = stats.engine;
+	char reason[STATS_REASON];
+	memcpy(reason, stats.engine_reason, sizeof(reason));
+	pthread_mutex_unlock(&engine_lock);
+
+	if (json) {
+		fprintf(stream, "{");
+		if (engine != NULL) {
+			fprintf(stream, "\"engine\": {\"name\": \"%s\", \"reason\": \"%s\"}, ", engine, reason);
+		}
+		fprintf(stream, "\"phases_s\": {");
+		for (size_t i = 0; i < PHASE_COUNT; i++) {
+			fprintf(stream, "%s\"%s\": %.9f", i == 0 ? "" : ", ", phase_names[i], phaseTime(i, now, &running) * 1e-9);
+		}
+		fprintf(stream, "}, \"operations\": {");
+		for (size_t i = 0; i < OP_COUNT; i++) {
+			fprintf(stream, "%s\"%s\": {\"calls\": %" PRIu64 ", \"histogram\": [", i == 0 ? "" : ", ", op_names[i], stats.calls[i]);
+			for (size_t b = 0; b < STATS_BUCKETS; b++) {
+				fprintf(stream, "%s%" PRIu64, b == 0 ? "" : ", ", stats.histogram[i][b]);
+			}
+			fprintf(stream, "]}");
+		}
+		fprintf(stream, "}, \"block_products\": %" PRIu64, stats.products);
+		fprintf(stream, ", \"allocations\": %" PRIu64 ", \"allocated_bytes\": %" PRIu64 ", \"peak_live_bytes\": %" PRIu64
+			", \"mappings\": %" PRIu64 ", \"huge_peak_bytes\": %" PRIu64 ", \"peak_rss_bytes\": %" PRIu64 "}\n",
+			stats.allocations, stats.allocated_bytes, stats.peak_bytes, stats.mappings, stats.huge_peak_bytes, statsPeakRss());
+		return;
+	}
+
+	if (engine != NULL) {
+		fprintf(stream, "Engine            %s (%s)\n", engine, reason);
+	}
+	fprintf(stream, "Phase             time [s]\n");
+	for (size_t i = 0; i < PHASE_COUNT; i++) {
+		uint64_t time = phaseTime(i, now, &running);
+		fprintf(stream, "  %-14s %10.6f%s\n", phase_names[i], time * 1e-9, running ? " (running)" : "");
+	}
+
+	fprintf(stream, "Operation          calls   by longer operand in blocks\n");
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		fprintf(stream, "  %-12s %10" PRIu64 " ", op_names[i], stats.calls[i]);
+		for (size_t b = 0; b < STATS_BUCKETS; b++) {
+			if (stats.histogram[i][b] != 0) {
+				fprintf(stream, "  %zu-%zu: %" PRIu64, (size_t)1 << b, ((size_t)2 << b) - 1, stats.histogram[i][b]);
+			}
+		}
+		fprintf(stream, "\n");
+	}
+	fprintf(stream, "  %-12s %10" PRIu64 "\n", "products", stats.products);
+
+	fprintf(stream, "Memory\n");
+	fprintf(stream, "  allocations    %10" PRIu64 "\n", stats.allocations);
+	fprintf(stream, "  allocated      %10" PRIu64 " bytes\n", stats.allocated_bytes);
+	fprintf(stream, "  peak live      %10" PRIu64 " bytes (%" PRIu64 " blocks)\n", stats.peak_bytes, stats.peak_bytes / 4);
+	fprintf(stream, "  mappings       %10" PRIu64 "\n", stats.mappings);
+	fprintf(stream, "  huge pages     %10" PRIu64 " bytes at most\n", stats.huge_peak_bytes);
+	fprintf(stream, "  peak rss       %10" PRIu64 " bytes\n", statsPeakRss());
+}
+
+/*
+ * Makes the calling thread count into the counters at target instead of stats, until it gets called with NULL; for measurements
+ * whose operations must not show up in the counters of runs computing at the same time
+ * The blocks allocated while counting into target have to be freed before switching back
+ */
+void statsRedirect(struct stats *target)
+{
+	statsMerge();
+	sink = target;
+}
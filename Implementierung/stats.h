@@ -0,0 +1,86 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Length of the reason stats keeps for the choice of the engine
+#define STATS_REASON 160
+
+// Size class b of the histograms holds operations whose longer operand has between 2^b and 2^(b+1) - 1 blocks
+#define STATS_BUCKETS 40
+
+enum stats_phase {
+	PHASE_SPLIT,
+	PHASE_DIVISION,
+	PHASE_SERIES,
+	PHASE_OUTPUT,
+	PHASE_VERIFY,
+	PHASE_COUNT
+};
+
+enum stats_op {
+	OP_MULT,
+	OP_ADD,
+	OP_SUB,
+	OP_COUNT
+};
+
+/*
+ * Counters of a run; updated atomically, so that they stay consistent if several threads compute at once
+ * The operation counters, products and allocations get collected per thread and added at the end of every library call and phase
+ * Times are stored in nanoseconds, memory in bytes of blocks
+ */
+struct stats {
+	uint64_t phase_ns[PHASE_COUNT];
+	// Start of the latest run of every phase still running, 0 for the others
+	uint64_t running_since[PHASE_COUNT];
+	uint64_t calls[OP_COUNT];
+	uint64_t histogram[OP_COUNT][STATS_BUCKETS];
+	// Block products of the base case multiplications, the work all karazuba steps come down to
+	uint64_t products;
+	uint64_t allocations;
+	uint64_t allocated_bytes;
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+	// Large blocks mapped with huge pages and the most memory of the process seen backed by huge pages
+	uint64_t mappings;
+	uint64_t huge_peak_bytes;
+	// Engine of the last computation and why it was chosen, NULL before the first one
+	const char *engine;
+	char engine_reason[STATS_REASON];
+};
+
+extern struct stats stats;
+
+extern const char *phase_names[PHASE_COUNT];
+
+uint64_t statsNow(void);
+
+uint64_t statsBegin(enum stats_phase phase);
+
+void statsPhase(enum stats_phase phase, uint64_t start);
+
+void statsOp(enum stats_op op, size_t length);
+
+void statsProducts(uint64_t count);
+
+void statsEngine(const char *name, const char *reason);
+
+void statsAlloc(size_t bytes);
+
+void statsFree(size_t bytes);
+
+void statsMerge(void);
+
+void statsReset(void);
+
+void statsRedirect(struct stats *target);
+
+uint64_t statsPeakRss(void);
+
+void statsPrint(FILE *stream, bool json);
+
+#endif
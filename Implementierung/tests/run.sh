@@ -0,0 +1,271 @@
+#!/bin/sh
+# Regression tests of the sqrt2 program against the known places of sqrt2, run by make test
+# sqrt2_hex.txt and sqrt2_dec.txt hold the first 10000 places after the comma, floor(sqrt2 * base^10000) without the leading 1
+# Usage: tests/run.sh [program] (default: ./sqrt2)
+
+program=${1:-./sqrt2}
+dir=$(dirname "$0")
+hex=$(cat "$dir/sqrt2_hex.txt")
+dec=$(cat "$dir/sqrt2_dec.txt")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+passed=0
+failed=0
+
+# Runs the program with a time limit, so that a run that hangs fails instead of blocking the tests
+run() {
+	timeout 120 "$program" "$@"
+}
+
+# Prints the places of the result line of a run
+result() {
+	run "$@" 2>/dev/null | sed -n 's/^Result: //p'
+}
+
+# Prints the known places from the first to the last one after the comma, of h(exadecimal) or d(ecimal)
+known() {
+	if [ "$1" = h ]; then
+		printf '%s' "$hex" | cut -c"$2"-"$3"
+	else
+		printf '%s' "$dec" | cut -c"$2"-"$3"
+	fi
+}
+
+check() {
+	if [ "$2" = "$3" ]; then
+		passed=$((passed + 1))
+	else
+		failed=$((failed + 1))
+		echo "FAIL: $1"
+	fi
+}
+
+# expect h|d <places> [options]: the run prints the places as 1,<places>
+expect() {
+	base=$1
+	places=$2
+	shift 2
+	if [ "$places" -eq 0 ]; then
+		wanted=1
+	else
+		wanted="1,$(known "$base" 1 "$places")"
+	fi
+	check "-$base$places $*" "$wanted" "$(result "-$base$places" "$@")"
+}
+
+# window h|d <places> <from> <count> [options]: the run prints the count places after the first from ones
+window() {
+	base=$1
+	places=$2
+	from=$3
+	count=$4
+	shift 4
+	check "-$base$places --from $from --count $count $*" "$(known "$base" $((from + 1)) $((from + count)))" \
+		"$(result "-$base$places" --from "$from" --count "$count" "$@")"
+}
+
+# leading <options>: the hexadecimal run of more than 10000 places starts with the 10000 known ones
+leading() {
+	check "$* first 10000 places" "1,$(known h 1 10000)" "$(result "$@" | cut -c1-10002)"
+}
+
+# reject <options>: the run fails in time and prints no result
+reject() {
+	run "$@" >"$tmp/out" 2>&1
+	status=$?
+	if [ $status -ne 0 ] && [ $status -ne 124 ] && ! grep -q '^Result' "$tmp/out"; then
+		passed=$((passed + 1))
+	else
+		failed=$((failed + 1))
+		echo "FAIL: $* was not rejected (exit status $status)"
+	fi
+}
+
+# Windows, at both ends of the places and with --count taken from -h or -d
+window h 1 0 1
+window h 1 100 50
+window h 1 9990 10
+window d 1 0 1
+window d 1 1000 37
+window d 1 9000 1000
+check "-h20 --from 5" "$(known h 6 25)" "$(result -h20 --from 5)"
+check "-d20 --from 5" "$(known d 6 25)" "$(result -d20 --from 5)"
+reject -h1 --from 18446744073709551615 --count 2
+reject -h1 --from 18446744073709551616 --count 2
+reject -d1 --from -1 --count 2
+reject -h1 --from abc --count 2
+reject -h5 --from 3 --count 0
+reject -h0 --from 3
+reject -h1 --from 1000000 --count 1
+reject -d1 --from 999999 --count 2
+reject -d1 --from 5 --count 18446744073709551615
+
+# Places beyond the cap of the command line, negative or no numbers at all get rejected for both bases
+for places in -5 -1 99999999999 1000001 18446744073709551616 abc 10x; do
+	reject -d"$places"
+	reject -h"$places"
+done
+check "-d without places prints 5" "1,$(known d 1 5)" "$(result -d)"
+
+# Every engine on both sides of the crossover of -V auto, and every kernel the processor supports
+for engine in auto series truncated split 0 1; do
+	for places in 0 1 2 31 1000 5000; do
+		expect h $places -V $engine
+	done
+	for places in 1 9 10 1000 5000; do
+		expect d $places -V $engine
+	done
+done
+expect h 10000 -V truncated
+expect h 10000 -V split
+expect d 10000
+for kernel in scalar avx2 ifma; do
+	if ! run -h1 --kernel $kernel >/dev/null 2>&1; then
+		echo "skipped: the processor cannot run the $kernel kernel"
+		continue
+	fi
+	for engine in series truncated split; do
+		expect h 8000 -V $engine --kernel $kernel
+		expect d 3000 -V $engine --kernel $kernel
+	done
+done
+reject -h5 -V fast
+
+# Threads of the splitting, also counts that are no power of two
+for threads in 2 3 8; do
+	expect h 10000 -V split --threads $threads
+	expect d 10000 -V truncated --threads $threads
+done
+
+# Worker processes executed by the coordinator, also with threads of their own and for extended runs
+for processes in 2 3; do
+	expect h 10000 -V truncated --processes $processes --threads 2
+	expect d 5000 -V truncated --processes $processes --verify
+done
+expect h 3000 --save "$tmp/p.pqt" --processes 2
+expect h 6000 --extend "$tmp/p.pqt" --processes 2
+
+# A worker answers jobs in the little-endian wire format and rejects ranges beyond SQRT2_MAX_TERMS
+printf 'SQRT2JOB\001\0\0\0\0\0\0\0\003\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\001\0\0\0\0\0\0\0' >"$tmp/job"
+check "--split-worker replies to a job" "SQRT2RES$(printf '\0\0\0\0\0\0\0\0' | od -An -c)" \
+	"SQRT2RES$(run --split-worker <"$tmp/job" 2>/dev/null | head -c 16 | tail -c 8 | od -An -c)"
+printf 'SQRT2JOB\001\0\0\0\0\0\0\0\0\0\0\0\0\002\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0' >"$tmp/job"
+reject --split-worker <"$tmp/job"
+
+# The series reports too many terms as an error of the request, the places of the command line stay below its limit
+check "-V series prints no debugging output" 0 "$(run -d10000 -V series 2>&1 >/dev/null | grep -c 'DEBUG')"
+expect d 10000 -V series
+
+# The truncated splitting reports failures of its error bound as errors of the run, never as debugging output
+check "-V truncated prints no debugging output" 0 "$(run -h10000 -V truncated --threads 8 2>&1 >/dev/null | grep -c 'DEBUG')"
+
+# Reruns of -B, with and without the hardware counters (reported as unavailable where the machine has none)
+expect h 3000 -B2
+expect h 3000 -B2 --perf -V split --threads 2
+expect d 1000 -B2 --perf --verify
+
+# Blocks of 1 MiB and more get mappings of their own, the run has to stay correct with them and with the page options
+run -h120000 -V split -B1 >"$tmp/mapped" 2>&1
+check "-h120000 -V split -B1 first 10000 places" "1,$(known h 1 10000)" "$(sed -n 's/^Result: //p' "$tmp/mapped" | cut -c1-10002)"
+check "-h120000 -V split -B1 maps blocks" yes "$(grep -q '^Memory: [1-9][0-9]* large blocks mapped' "$tmp/mapped" && echo yes || echo no)"
+expect h 5000 --no-huge-pages
+expect d 5000 -V split --numa interleave --threads 2
+expect h 5000 -V truncated --numa local
+
+# SIGUSR1 sends the progress and the counters with the time of the running phase, only while reporting; without --progress or
+# --progress-file it must not end the run
+"$program" -h150000 -V truncated >"$tmp/usr1" 2>&1 &
+pid=$!
+sleep 1
+kill -USR1 $pid
+wait $pid
+check "SIGUSR1 without --progress keeps running" "1,$(known h 1 10000)" "$(sed -n 's/^Result: //p' "$tmp/usr1" | cut -c1-10002)"
+"$program" -h150000 -V truncated --progress-file "$tmp/status" >"$tmp/usr1" 2>"$tmp/dump" &
+pid=$!
+sleep 1
+kill -USR1 $pid
+wait $pid
+check "SIGUSR1 with --progress-file" "1,$(known h 1 10000)" "$(sed -n 's/^Result: //p' "$tmp/usr1" | cut -c1-10002)"
+check "SIGUSR1 dumps the progress" 1 "$(grep -c '^Progress: ' "$tmp/dump")"
+check "SIGUSR1 dumps the time of the running phase" 1 "$(grep -c '^  [a-z]* *[0-9.]* (running)$' "$tmp/dump")"
+check "--progress-file ends with done" 1 "$(grep -c '^Progress: done' "$tmp/status")"
+expect h 5000 -V split --progress=0.01
+
+# --estimate predicts from fixed costs without tuning.h, the same every time; the comparison shows the resident set only as measured
+if [ ! -e "$dir/../tuning.h" ]; then
+	check "--estimate is reproducible" "$(run -h100000 --estimate)" "$(run -h100000 --estimate)"
+fi
+run -h20000 --estimate=compare >"$tmp/compared" 2>&1
+check "--estimate=compare prints the result" "1,$(known h 1 10000)" "$(sed -n 's/^Result: //p' "$tmp/compared" | cut -c1-10002)"
+check "--estimate=compare predicts no rss" 1 "$(grep -c '^  peak rss  *- ' "$tmp/compared")"
+check "--estimate=compare predicts the live blocks" 1 "$(grep -c '^  peak live  *[0-9.]*  *[0-9.]* MiB' "$tmp/compared")"
+
+# Runs within memory budgets right above the planned peaks; saved runs that cannot fit fail before computing anything
+leading -h200000 -V truncated --threads 4 --max-mem 10
+leading -h200000 -V split --max-mem 13
+leading -h200000 --save "$tmp/m.pqt" --max-mem 18
+reject -h400000 -V split --max-mem 26 --save "$tmp/m.pqt"
+check "-h400000 --max-mem 26 --save is refused up front" 1 \
+	"$(run -h400000 -V split --max-mem 26 --save "$tmp/m.pqt" 2>&1 | grep -c '^Memory budget of 26 MiB is too small')"
+reject -h100000 -V truncated --max-mem 1
+for budget in abc -1 0 1x 17592186044416 18446744073709551616; do
+	reject -h100 --max-mem "$budget"
+done
+
+# Saved runs extended to more and fewer places, in both bases and across the precision the stored reciprocal doubles to
+expect h 1000 --save "$tmp/a.pqt"
+expect h 1000 --extend "$tmp/a.pqt"
+expect h 1100 --extend "$tmp/a.pqt" --verify
+expect h 10000 --extend "$tmp/a.pqt" --save "$tmp/b.pqt"
+expect h 500 --extend "$tmp/b.pqt"
+expect d 10000 --extend "$tmp/a.pqt" --verify
+expect d 3000 --save "$tmp/c.pqt" --threads 3
+expect h 9000 --extend "$tmp/c.pqt" --threads 3
+reject -h100 --extend "$tmp/missing.pqt"
+reject -h100 -V truncated --save "$tmp/d.pqt"
+
+# The digit cache serves fewer places from a stored entry, and --cache-limit removes the oldest entries of the directory
+expect h 2000 --cache "$tmp/cache"
+expect h 1000 --cache "$tmp/cache"
+expect d 500 --cache "$tmp/cache"
+check "-h1000 --cache hits" 1 "$(run -h1000 --cache "$tmp/cache" | grep -c '^Cache hit')"
+head -c 2000000 /dev/zero >"$tmp/cache/sqrt2_99999999.bin"
+touch -t 202001010000 "$tmp/cache/sqrt2_99999999.bin"
+expect h 3000 --cache "$tmp/cache" --cache-limit 1
+check "--cache-limit removes the oldest entry" no "$([ -e "$tmp/cache/sqrt2_99999999.bin" ] && echo yes || echo no)"
+expect h 3000 --cache "$tmp/cache" --cache-limit 1
+
+for limit in abc -1 0 1x 17592186044416 18446744073709551616; do
+	reject -h100 --cache "$tmp/cache" --cache-limit "$limit"
+done
+
+# Runs storing the same precision at once each write a temporary file of their own, and none of their counts get lost
+for i in 1 2 3 4 5 6; do
+	run -h3000 --cache "$tmp/shared" >/dev/null 2>&1 &
+done
+wait
+check "concurrent stores leave no temporary files" "sqrt2_12032.bin stats" "$(ls "$tmp/shared" | tr '\n' ' ' | sed 's/ $//')"
+check "concurrent runs count every request" 6 "$(awk '{ print $2 + $4 }' "$tmp/shared/stats")"
+expect h 3000 --cache "$tmp/shared" --verify
+check "the stored entry serves the request" 7 "$(awk '{ print $2 + $4 }' "$tmp/shared/stats")"
+
+# --serve answers requests line by line and rejects the ones beyond the cap of the command line; errors come right away, so the
+# order of the lines may differ from the one of the requests
+printf 'hex 100\ndec 2000000\nhex -1\nhex 1000001\nfoo\ndec 50\n' | run --serve --workers 1 >"$tmp/served" 2>&1
+check "--serve hex 100" "hex 100 1,$(known h 1 100)" "$(grep '^hex' "$tmp/served" | cut -d' ' -f1,2,5)"
+check "--serve dec 50" "dec 50 1,$(known d 1 50)" "$(grep '^dec' "$tmp/served" | cut -d' ' -f1,2,5)"
+check "--serve rejects dec 2000000 and hex 1000001" 2 "$(grep -c '^error too many places, at most 1000000 per request$' "$tmp/served")"
+check "--serve rejects hex -1" 1 "$(grep -c '^error invalid number of places$' "$tmp/served")"
+check "--serve rejects foo" 1 "$(grep -c '^error unknown request' "$tmp/served")"
+
+# --verify passes correct results of every engine and rejects a cache entry with a corrupted block
+for engine in series truncated split; do
+	expect h 3000 -V $engine --verify
+	expect d 3000 -V $engine --verify
+done
+run -h100 --cache "$tmp/corrupt" >/dev/null 2>&1
+printf '\377\377\377\377' | dd of="$tmp/corrupt/sqrt2_432.bin" bs=1 seek=40 conv=notrunc 2>/dev/null
+reject -h100 --cache "$tmp/corrupt" --verify
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]
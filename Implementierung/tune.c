@@ -0,0 +1,483 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "context.h"
+#include "kernels.h"
+#include "operations.h"
+#include "estimate.h"
+#include "plan.h"
+#include "stats.h"
+
+static const char* tune_usage_msg =
+	"Usage: %s [options]	Measures the thresholds and the costs of the arithmetic and the crossover of the engines on this machine and prints them as tuning.h\n";
+
+static const char* tune_help_msg =
+	"Optional arguments:\n"
+	"  --reps <int>	Measured repetitions per timing, the median counts (default: 5)\n"
+	"  --max <int>	Largest operand length in blocks tried as base case (default: 1024)\n"
+	"  --digits <int>	Hexadecimal places computed to time the parallel grain and to measure the memory (default: 100000)\n"
+	"  --help		Shows help message (this text) and exit\n"
+	"Example:\n"
+	"  ./sqrt2_tune > tuning.h\n";
+
+// Smallest time a timing repeats its multiplication for, so that short products are not lost in the resolution of the clock
+#define MIN_TIME 0.002
+
+// Largest number of hexadecimal places the engines are compared at
+#define ENGINE_MAX_PLACES 65536
+
+// Parallel grains tried, in terms of the splitting
+static const size_t grains[] = {32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+#define GRAIN_COUNT (sizeof(grains) / sizeof(grains[0]))
+
+// Most threads the growth of the memory of the truncated splitting is measured at, doubling from two
+#define MEMORY_THREADS 8
+
+// Values of the memory model, in the order of memory_macros
+enum {
+	MEMORY_SPLIT,
+	MEMORY_SAVED,
+	MEMORY_TRUNCATED,
+	MEMORY_THREADS_EXPONENT,
+	MEMORY_SERIES,
+	MEMORY_COUNT
+};
+
+static const char *memory_macros[MEMORY_COUNT] = {"TUNING_MEMORY_SPLIT", "TUNING_MEMORY_SAVED", "TUNING_MEMORY_TRUNCATED",
+	"TUNING_MEMORY_THREADS", "TUNING_MEMORY_SERIES"};
+
+static struct sqrt2_ctx *ctx;
+static size_t reps = 5;
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15;
+
+/*
+ * xorshift64, fixed seed so that every run measures the same operands
+ */
+static uint32_t nextRandom(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state >> 32;
+}
+
+/*
+ * Initializes num as integer of the given amount of random blocks with a non zero leading block
+ */
+static void randomBignum(struct bignum *num, size_t blocks)
+{
+	num->numbers = limbsAlloc(blocks + 1);
+	for (size_t i = 0; i < blocks; i++) {
+		num->numbers[i] = nextRandom();
+	}
+	num->numbers[blocks - 1] |= 1;
+	num->length = blocks;
+	num->subone = 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Sets the thresholds the following library calls and multiplications use
+ */
+static void setTuning(size_t mult_basecase, size_t parallel_grain)
+{
+	struct sqrt2_tuning tuning = {mult_basecase, parallel_grain};
+	if (sqrt2CtxSetTuning(ctx, &tuning) != SQRT2_OK) {
+		fprintf(stderr, "Error while setting the thresholds!\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Returns the median time of one product of two operands of n blocks, multiplied directly up to basecase blocks
+ * Runs in a library call on ctx, so that karazMult reads the base case from its tuning
+ */
+static double timeMult(size_t n, size_t basecase)
+{
+	setTuning(basecase, TUNING_PARALLEL_GRAIN);
+
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		fprintf(stderr, "Error while multiplying %zu blocks!\n", n);
+		exit(EXIT_FAILURE);
+	}
+
+	struct bignum x, y;
+	randomBignum(&x, n);
+	randomBignum(&y, n);
+
+	// One unmeasured product finds the number of products that take at least MIN_TIME
+	double start = now();
+	struct bignum res = karazMult(&x, &y);
+	double once = now() - start;
+	bignumFree(&res);
+	size_t count = once < MIN_TIME ? (size_t)(MIN_TIME / (once + 1e-9)) + 1 : 1;
+
+	double times[reps];
+	for (size_t i = 0; i < reps; i++) {
+		start = now();
+		for (size_t j = 0; j < count; j++) {
+			res = karazMult(&x, &y);
+			bignumFree(&res);
+		}
+		times[i] = (now() - start) / count;
+	}
+	bignumFree(&x);
+	bignumFree(&y);
+	trackerEnd(&tracker);
+
+	qsort(times, reps, sizeof(double), compareDouble);
+	return times[reps / 2];
+}
+
+/*
+ * Returns the median time of computing places hexadecimal places with the given engine
+ */
+static double timeEngine(enum sqrt2_engine engine, size_t places)
+{
+	sqrt2CtxSetEngine(ctx, engine);
+	double times[reps];
+	for (size_t i = 0; i < reps; i++) {
+		// The context keeps its result, every repetition has to compute again
+		sqrt2CtxClear(ctx);
+		char *text;
+		size_t length;
+		double start = now();
+		if (sqrt2Digits(ctx, 16, places, &text, &length) != SQRT2_OK) {
+			fprintf(stderr, "Error while computing %zu places!\n", places);
+			exit(EXIT_FAILURE);
+		}
+		times[i] = now() - start;
+		sqrt2FreeText(ctx, text);
+	}
+	sqrt2CtxClear(ctx);
+	qsort(times, reps, sizeof(double), compareDouble);
+	return times[reps / 2];
+}
+
+/*
+ * Returns the working precision in bits from which the truncated splitting computes faster than the series
+ * The places grow by a quarter, a crossover counts once the splitting wins twice in a row, so that noise does not end the search;
+ * if the series wins up to ENGINE_MAX_PLACES the crossover is put right above them
+ */
+static size_t tuneEngines(size_t basecase)
+{
+	setTuning(basecase, TUNING_PARALLEL_GRAIN);
+	size_t wins = 0;
+	size_t first_win = 0;
+	size_t places = 256;
+	for (; places <= ENGINE_MAX_PLACES; places += places / 4) {
+		double series = timeEngine(SQRT2_ENGINE_SERIES, places);
+		double split = timeEngine(SQRT2_ENGINE_TRUNCATED, places);
+		fprintf(stderr, "%6zu places: series %10.3f ms, truncated splitting %10.3f ms\n", places, 1e3 * series, 1e3 * split);
+		if (split < series) {
+			if (wins++ == 0) {
+				first_win = places;
+			}
+			if (wins == 2) {
+				break;
+			}
+		} else {
+			wins = 0;
+		}
+	}
+	sqrt2CtxSetEngine(ctx, SQRT2_ENGINE_AUTO);
+
+	struct plan plan;
+	planCompute(&plan, wins == 2 ? first_win : places, 16);
+	return wins == 2 ? plan.prec : plan.prec + 1;
+}
+
+/*
+ * Returns the most bytes of blocks live at once while computing places hexadecimal places with the engine and threads, or while
+ * computing them as a saved run that keeps its state if saved is set
+ */
+static double peakBytes(enum sqrt2_engine engine, size_t threads, size_t places, bool saved)
+{
+	sqrt2CtxSetEngine(ctx, engine);
+	sqrt2CtxSetThreads(ctx, threads);
+	// The context keeps its result, it would count towards the peak of the next run
+	sqrt2CtxClear(ctx);
+	statsReset();
+	int status;
+	if (saved) {
+		struct bignum result;
+		size_t loaded_terms;
+		status = sqrt2Extend(ctx, 16, places, NULL, NULL, &loaded_terms, &result);
+		if (status == SQRT2_OK) {
+			bignumFree(&result);
+		}
+	} else {
+		char *text;
+		size_t length;
+		status = sqrt2Digits(ctx, 16, places, &text, &length);
+		if (status == SQRT2_OK) {
+			sqrt2FreeText(ctx, text);
+		}
+	}
+	if (status != SQRT2_OK) {
+		fprintf(stderr, "Error while computing %zu places!\n", places);
+		exit(EXIT_FAILURE);
+	}
+	double peak = stats.peak_bytes;
+	sqrt2CtxClear(ctx);
+	sqrt2CtxSetThreads(ctx, 1);
+	sqrt2CtxSetEngine(ctx, SQRT2_ENGINE_AUTO);
+	return peak;
+}
+
+/*
+ * Measures the memory model of planMemory at places hexadecimal places into memory, in hundredths of its units: the peaks of the
+ * exact splitting and of saved runs per byte of Q(1, n), of the truncated splitting and the series per byte of the working
+ * precision, and the exponent the peak of the truncated splitting grows with in the threads
+ */
+static void tuneMemory(unsigned long memory[MEMORY_COUNT], size_t places, size_t basecase)
+{
+	setTuning(basecase, TUNING_PARALLEL_GRAIN);
+	struct plan plan;
+	planCompute(&plan, places, 16);
+	double split = planSplitBytes(&plan);
+	double prec = planPrecBytes(&plan);
+
+	// The growth in the threads is no exact power, the steepest one measured keeps the estimate above the peaks of all of them
+	double truncated = peakBytes(SQRT2_ENGINE_TRUNCATED, 1, places, false) / prec;
+	double exponent = 0;
+	for (size_t threads = 2; threads <= MEMORY_THREADS; threads *= 2) {
+		double threaded = peakBytes(SQRT2_ENGINE_TRUNCATED, threads, places, false) / prec;
+		if (threaded > truncated && log(threaded / truncated) / log(threads) > exponent) {
+			exponent = log(threaded / truncated) / log(threads);
+		}
+	}
+	double factors[MEMORY_COUNT] = {
+		[MEMORY_SPLIT] = peakBytes(SQRT2_ENGINE_SPLIT, 1, places, false) / split,
+		[MEMORY_SAVED] = peakBytes(SQRT2_ENGINE_SPLIT, 1, places, true) / split,
+		[MEMORY_TRUNCATED] = truncated,
+		[MEMORY_THREADS_EXPONENT] = exponent,
+		[MEMORY_SERIES] = peakBytes(SQRT2_ENGINE_SERIES, 1, places, false) / prec,
+	};
+	for (size_t k = 0; k < MEMORY_COUNT; k++) {
+		memory[k] = (unsigned long)ceil(100 * factors[k]);
+	}
+	fprintf(stderr, "memory at %zu places: split %.2f, saved %.2f times Q(1, n), truncated %.2f times the precision growing with threads^%.2f, "
+		"series %.2f times the precision\n", places, factors[MEMORY_SPLIT], factors[MEMORY_SAVED], truncated,
+		factors[MEMORY_THREADS_EXPONENT], factors[MEMORY_SERIES]);
+}
+
+/*
+ * Measures the costs --estimate predicts runs from, in a library call on ctx so that the products use the measured base case
+ */
+static void tuneCosts(struct machine_costs *costs, size_t basecase)
+{
+	setTuning(basecase, TUNING_PARALLEL_GRAIN);
+
+	struct tracker tracker;
+	trackerBegin(&tracker, ctx);
+	if (setjmp(tracker.jump) != 0) {
+		trackerAbort(&tracker);
+		fprintf(stderr, "Error while measuring the costs!\n");
+		exit(EXIT_FAILURE);
+	}
+	estimateMeasure(costs);
+	trackerEnd(&tracker);
+
+	fprintf(stderr, "costs: product %.3f ns, row %.1f ns, karazuba step %.3f ns, linear %.3f ns, division %.3f ns, printing %.3f ns, call %.1f ns\n",
+		costs->product_ns, costs->row_ns, costs->step_ns, costs->linear_ns, costs->divide_ns, costs->print_ns, costs->call_ns);
+}
+
+/*
+ * Returns the largest operand length the kernel multiplies faster directly than by one karazuba step on halves multiplied directly
+ * The lengths grow by an eighth, a crossover counts once the karazuba step wins twice in a row, so that noise does not end the search
+ */
+static size_t tuneBasecase(const char *name, size_t max)
+{
+	if (!kernelSelect(name)) {
+		return 0;
+	}
+
+	size_t basecase = max;
+	size_t wins = 0;
+	size_t last_loss = 0;
+	for (size_t n = 16; n <= max; n = (n + n / 8 + 1) & ~(size_t)1) {
+		double direct = timeMult(n, n);
+		double split = timeMult(n, n / 2);
+		fprintf(stderr, "%-7s %5zu blocks: direct %10.3f us, karazuba %10.3f us\n", name, n, 1e6 * direct, 1e6 * split);
+		if (split < direct) {
+			if (++wins == 2) {
+				basecase = last_loss != 0 ? last_loss : 16;
+				break;
+			}
+		} else {
+			wins = 0;
+			last_loss = n;
+		}
+	}
+	return basecase;
+}
+
+/*
+ * Returns the parallel grain computing digits hexadecimal places fastest with one thread per processor, 0 if there is only one
+ */
+static size_t tuneGrain(size_t digits, size_t basecase)
+{
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	if (processors < 2) {
+		fprintf(stderr, "Only one processor, the parallel grain keeps its default\n");
+		return 0;
+	}
+	sqrt2CtxSetThreads(ctx, processors);
+
+	size_t best = 0;
+	double best_time = 0;
+	for (size_t g = 0; g < GRAIN_COUNT; g++) {
+		setTuning(basecase, grains[g]);
+		double times[reps];
+		for (size_t i = 0; i < reps; i++) {
+			// The context keeps its result, every repetition has to compute again
+			sqrt2CtxClear(ctx);
+			char *text;
+			size_t length;
+			double start = now();
+			if (sqrt2Digits(ctx, 16, digits, &text, &length) != SQRT2_OK) {
+				fprintf(stderr, "Error while computing %zu places!\n", digits);
+				exit(EXIT_FAILURE);
+			}
+			times[i] = now() - start;
+			sqrt2FreeText(ctx, text);
+		}
+		qsort(times, reps, sizeof(double), compareDouble);
+		fprintf(stderr, "grain %5zu terms: %10.3f ms with %ld threads\n", grains[g], 1e3 * times[reps / 2], processors);
+		if (best == 0 || times[reps / 2] < best_time) {
+			best = grains[g];
+			best_time = times[reps / 2];
+		}
+	}
+	sqrt2CtxClear(ctx);
+	sqrt2CtxSetThreads(ctx, 1);
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	size_t max = 1024;
+	size_t digits = 100000;
+
+	static struct option long_options[] = {
+		{"reps",      required_argument,  0,  'r' },
+		{"max",       required_argument,  0,  'm' },
+		{"digits",    required_argument,  0,  'd' },
+		{"help",      no_argument,	   0,  'h' },
+		{0,	      0,		   0,  0 }
+	};
+
+	int opt;
+	int long_index = 0;
+	while ((opt = getopt_long(argc, argv, "", long_options, &long_index)) != -1) {
+		switch (opt) {
+			case 'r':
+				reps = strtoull(optarg, NULL, 10);
+				if (reps == 0) {
+					fprintf(stderr, "At least one repetition is needed!\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'm':
+				max = strtoull(optarg, NULL, 10);
+				if (max < 16) {
+					fprintf(stderr, "The largest base case has to be at least 16 blocks!\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'd':
+				digits = strtoull(optarg, NULL, 10);
+				if (digits == 0) {
+					fprintf(stderr, "At least one place is needed!\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				fprintf(stderr, tune_usage_msg, argv[0]);
+				fprintf(stderr, "\n%s", tune_help_msg);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if (sqrt2CtxCreate(&ctx, NULL) != SQRT2_OK) {
+		fprintf(stderr, "Error while creating the context!\n");
+		return EXIT_FAILURE;
+	}
+
+	const char *names[] = {"scalar", "avx2", "ifma"};
+	const char *macros[] = {"TUNING_BASECASE_SCALAR", "TUNING_BASECASE_AVX2", "TUNING_BASECASE_IFMA"};
+	size_t basecases[3];
+	size_t fastest = 0;
+	for (size_t k = 0; k < 3; k++) {
+		basecases[k] = tuneBasecase(names[k], max);
+		if (basecases[k] != 0) {
+			fastest = k;
+		}
+	}
+
+	// The splitting runs on the fastest kernel, the one detected without --kernel
+	kernelSelect(names[fastest]);
+	size_t grain = tuneGrain(digits, basecases[fastest]);
+	size_t engine_bits = tuneEngines(basecases[fastest]);
+	struct machine_costs costs;
+	tuneCosts(&costs, basecases[fastest]);
+	unsigned long memory[MEMORY_COUNT];
+	tuneMemory(memory, digits, basecases[fastest]);
+
+	printf("#ifndef TUNING_H\n");
+	printf("#define TUNING_H\n\n");
+	printf("// Written by make tune; to return to the defaults delete this file and rebuild after make clean\n\n");
+	for (size_t k = 0; k < 3; k++) {
+		if (basecases[k] != 0) {
+			printf("#define %s %zu\n", macros[k], basecases[k]);
+		} else {
+			printf("// %s not measured, the processor cannot run the %s kernel\n", macros[k], names[k]);
+		}
+	}
+	if (grain != 0) {
+		printf("#define TUNING_PARALLEL_GRAIN %zu\n", grain);
+	} else {
+		printf("// TUNING_PARALLEL_GRAIN not measured on a single processor\n");
+	}
+	printf("#define TUNING_ENGINE_SPLIT_BITS %zu\n", engine_bits);
+	// Picoseconds, so that the costs stay integers; at least one, so that no cost drops out of the predictions
+	const char *cost_macros[] = {"TUNING_PRODUCT_PS", "TUNING_ROW_PS", "TUNING_STEP_PS", "TUNING_LINEAR_PS", "TUNING_DIVIDE_PS",
+		"TUNING_PRINT_PS", "TUNING_CALL_PS"};
+	double cost_values[] = {costs.product_ns, costs.row_ns, costs.step_ns, costs.linear_ns, costs.divide_ns, costs.print_ns,
+		costs.call_ns};
+	for (size_t k = 0; k < 7; k++) {
+		printf("#define %s %.0f\n", cost_macros[k], cost_values[k] * 1e3 >= 1 ? cost_values[k] * 1e3 : 1);
+	}
+	for (size_t k = 0; k < MEMORY_COUNT; k++) {
+		printf("#define %s %lu\n", memory_macros[k], memory[k]);
+	}
+	printf("\n#endif\n");
+
+	sqrt2CtxDestroy(ctx);
+	return EXIT_SUCCESS;
+}